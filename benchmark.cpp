@@ -0,0 +1,73 @@
+//
+// Micro-benchmark of the command response parser, built with -DSRI_FTSENSOR_SDK_BENCHMARK=ON:
+//     ./benchmark [iterations]
+// Prints the time per parse of typical M8128 responses. Nothing is sent to a sensor.
+//
+
+#include <sri/responseparser.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace SRI;
+
+/// Run a parse repeatedly and print the mean time per call
+/// \return false if the parse failed
+template<typename Parse>
+static bool measure(const char *name, uint32_t iterations, Parse parse) {
+    ParseError error = parse(); // warm up
+    if (error != ParseError::None) {
+        std::printf("%-24s failed: %s\n", name, toString(error));
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        error = parse();
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-24s %10.1f ns\n", name, ns / iterations);
+    return error == ParseError::None;
+}
+
+static const int8_t *bytes(const std::string &text) {
+    return reinterpret_cast<const int8_t *>(text.data());
+}
+
+int main(int argc, char **argv) {
+    uint32_t iterations = argc > 1 ? uint32_t(std::atol(argv[1])) : 1000000;
+    if (iterations == 0)
+        iterations = 1;
+
+    const std::string rate = "ACK+SMPR=1000$OK\r\n";
+    const std::string gains = "ACK+CHNAPG=124.9578;124.9531;124.8993;125.0012;124.9764;125.0197$OK\r\n";
+    const std::string mode = "ACK+SGDM=(A01,A02,A03,A04,A05,A06);E;1;(WMA:1,1,2,3)$OK\r\n";
+    const std::string set = "ACK+SMPR=1000$OK\r\n";
+
+    boost::string_view payload;
+    uint32_t value = 0;
+    std::vector<float> values;
+    values.reserve(RT_MAX_CHANNELS);
+    RTDataMode rtMode;
+
+    bool ok = true;
+    ok &= measure("sampling rate", iterations, [&]() {
+        ParseError error = parseQueryResponse(bytes(rate), rate.size(), SMPR, payload);
+        return error == ParseError::None ? parseUnsigned(payload, value) : error;
+    });
+    ok &= measure("channel gains", iterations, [&]() {
+        ParseError error = parseQueryResponse(bytes(gains), gains.size(), CHNAPG, payload);
+        return error == ParseError::None ? parseFloatList(payload, ';', values) : error;
+    });
+    ok &= measure("real time data mode", iterations, [&]() {
+        ParseError error = parseQueryResponse(bytes(mode), mode.size(), SGDM, payload);
+        return error == ParseError::None ? parseRealTimeDataMode(payload, rtMode) : error;
+    });
+    ok &= measure("setting accepted", iterations, [&]() {
+        return parseSetResponse(bytes(set), set.size(), SMPR);
+    });
+    return ok ? 0 : 1;
+}
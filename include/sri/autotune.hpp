@@ -0,0 +1,120 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_AUTOTUNE_HPP
+#define SRI_FTSENSOR_SDK_AUTOTUNE_HPP
+
+#include <sri/types.hpp>
+#include <sri/timing.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace SRI {
+    struct AutoTuneConfig {
+        double CpuBudget = 0.05;    // maximum RTTiming::Load of the receiving thread, 0 for no limit
+        double MaxLatencyUs = 0;    // maximum age of a sample when its callback returns, 0 for no limit
+        std::vector<uint16_t> Candidates = {1, 2, 4, 5, 8, 10, 16, 20, 25, 32, 50}; // PNpCH values to try
+        uint32_t MeasureMs = 500;   // streaming time per candidate
+    };
+
+    /// Measurement of one candidate
+    struct AutoTuneTrial {
+        uint16_t PNpCH = 0;
+        RTTiming Timing;
+        double Latency = 0;         // ns, accumulation of the frame plus the measured mean delivery latency
+        bool Accepted = false;
+    };
+
+    struct AutoTuneResult {
+        bool Success = false;       // a candidate met the budget and the latency limit
+        uint16_t PNpCH = 0;         // the chosen candidate
+        std::vector<AutoTuneTrial> Trials;
+    };
+
+    /// Picks the smallest PNpCH that meets a CPU budget and a latency limit from measurements.
+    /// Candidates are tried in ascending order. A larger PNpCH lowers the per-sample overhead but the
+    /// first sample of a frame waits (PNpCH - 1) / SMPR for the rest, so the search ends at the first
+    /// candidate that meets both limits or the first one that misses the latency limit.
+    class RTAutoTuner {
+    public:
+        /// \param config   The limits and candidates
+        /// \param rate     The sampling rate SMPR in Hz
+        RTAutoTuner(const AutoTuneConfig &config, SampleRate rate) : _config(config), _rate(rate) {
+            std::vector<uint16_t> &c = _config.Candidates;
+            c.erase(std::remove(c.begin(), c.end(), uint16_t(0)), c.end());
+            std::sort(c.begin(), c.end());
+            c.erase(std::unique(c.begin(), c.end()), c.end());
+        }
+
+        /// Get the next candidate to measure
+        /// \param[out] pnpch   The candidate
+        /// \return             false once the search has ended
+        bool next(uint16_t &pnpch) {
+            if (_done || _index >= _config.Candidates.size() || _rate == 0)
+                return false;
+            uint16_t candidate = _config.Candidates[_index];
+            if (_config.MaxLatencyUs > 0 && accumulation(candidate) > _config.MaxLatencyUs * 1e3) {
+                _done = true;
+                return false;
+            }
+            pnpch = candidate;
+            return true;
+        }
+
+        /// Report the measurement of the candidate returned by next()
+        void report(const RTTiming &timing) {
+            AutoTuneTrial trial;
+            trial.PNpCH = _config.Candidates[_index];
+            trial.Timing = timing;
+            trial.Latency = accumulation(trial.PNpCH) + timing.MeanLatency;
+            bool inBudget = _config.CpuBudget <= 0 || timing.Load <= _config.CpuBudget;
+            bool inTime = _config.MaxLatencyUs <= 0 || trial.Latency <= _config.MaxLatencyUs * 1e3;
+            trial.Accepted = timing.Frames > 0 && inBudget && inTime;
+            _result.Trials.push_back(trial);
+
+            if (trial.Accepted) {
+                _result.Success = true;
+                _result.PNpCH = trial.PNpCH;
+                _done = true;
+            } else if (timing.Frames == 0 || !inTime) {
+                _done = true; // no data, or larger candidates only add latency
+            } else {
+                _index++;
+            }
+        }
+
+        const AutoTuneResult &result() const {
+            return _result;
+        }
+
+    private:
+        /// Time in ns the first sample of a frame waits for the others
+        double accumulation(uint16_t pnpch) const {
+            return (pnpch - 1) * 1e9 / _rate;
+        }
+
+        AutoTuneConfig _config;
+        SampleRate _rate;
+        size_t _index = 0;          // current candidate
+        bool _done = false;
+        AutoTuneResult _result;
+    }; // class RTAutoTuner
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_AUTOTUNE_HPP
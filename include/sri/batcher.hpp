@@ -0,0 +1,212 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_BATCHER_HPP
+#define SRI_FTSENSOR_SDK_BATCHER_HPP
+
+#include <sri/types.hpp>
+#include <sri/rtcolumns.hpp>
+
+#include <boost/function.hpp>
+
+#include <algorithm>
+#include <utility>
+
+namespace SRI {
+    /// Accumulates decoded samples and hands them over once per maxSamples samples
+    /// or once the oldest sample is maxDelay old, whichever comes first.
+    /// The batch vector and the sample vectors inside it are reused, a partial batch parks the unused samples
+    /// until it comes back. A handler that moves the batch away, like the queue, has to return storage
+    /// through the batch (FTSensor refills it from the queue's ObjectPool), otherwise the next batch allocates.
+    /// \tparam T The real time data format
+    template<typename T>
+    class RTBatcher {
+    public:
+        typedef boost::function<void(std::vector<RTData<T>>&)> BatchHandler;
+
+        /// \param handler      Called with every completed batch
+        /// \param maxSamples   Number of samples in a full batch
+        /// \param maxDelayUs   Maximum age of the oldest sample before a partial batch is handed over, 0 for no limit
+        RTBatcher(BatchHandler handler, size_t maxSamples, uint32_t maxDelayUs)
+                : _handler(handler), _maxSamples(maxSamples > 0 ? maxSamples : 1),
+                  _maxDelay(uint64_t(maxDelayUs) * 1000), _batch(_maxSamples) {
+            _spare.reserve(_maxSamples);
+        }
+
+        /// Add the samples of one frame
+        /// \param rtData       The decoded samples
+        /// \param timestamp    The current time in ns
+        void add(std::vector<RTData<T>> &rtData, uint64_t timestamp) {
+            for (auto &data : rtData) {
+                if (data.Data.size() != _channels) {
+                    _channels = data.Data.size();
+                    reserveSamples(_count);
+                }
+                if (_count == 0)
+                    _firstTimestamp = data.Timestamp;
+                if (_count == _batch.size())
+                    _batch.resize(_count + 1);
+
+                _batch[_count].DataNumber = data.DataNumber;
+                _batch[_count].Timestamp = data.Timestamp;
+                _batch[_count].Data.assign(data.Data.begin(), data.Data.end());
+                _count++;
+
+                if (_count == _maxSamples)
+                    flush();
+            }
+
+            poll(timestamp);
+        }
+
+        /// Hand over a partial batch if its oldest sample is too old
+        /// \param timestamp The current time in ns
+        void poll(uint64_t timestamp) {
+            if (_count > 0 && _maxDelay > 0 && timestamp >= _firstTimestamp + _maxDelay)
+                flush();
+        }
+
+        /// Hand over whatever has been accumulated
+        void flush() {
+            if (_count == 0)
+                return;
+
+            if (_count < _batch.size()) {
+                // keep the sample vectors of the unused tail instead of destroying them,
+                // parked in reverse so that the used ones near the front come back first
+                while (_batch.size() > _count) {
+                    _spare.push_back(std::move(_batch.back()));
+                    _batch.pop_back();
+                }
+            }
+
+            _handler(_batch);
+            _count = 0;
+
+            // the batch may come back with fewer or more samples, none are destroyed so that
+            // the samples in circulation stop growing once there are enough of them
+            while (_batch.size() > _maxSamples) {
+                _spare.push_back(std::move(_batch.back()));
+                _batch.pop_back();
+            }
+            while (_batch.size() < _maxSamples && !_spare.empty()) {
+                _batch.push_back(std::move(_spare.back()));
+                _spare.pop_back();
+            }
+
+            if (_batch.size() < _maxSamples) {
+                size_t size = _batch.size();
+                _batch.resize(_maxSamples);
+                reserveSamples(size);
+            }
+        }
+
+    private:
+        /// Give the sample vectors from the given one on room for all channels, so that the first
+        /// batch reaching them does not allocate
+        void reserveSamples(size_t begin) {
+            for (size_t i = begin; i < _batch.size(); i++) {
+                _batch[i].Data.reserve(_channels);
+            }
+        }
+
+        BatchHandler _handler;              // receives the completed batches
+        size_t _maxSamples;                 // samples per full batch
+        uint64_t _maxDelay;                 // maximum age of a partial batch in ns
+        std::vector<RTData<T>> _batch;      // reused batch storage
+        std::vector<RTData<T>> _spare;      // samples parked by partial batches
+        size_t _count = 0;                  // samples in the current batch
+        size_t _channels = 0;               // channels of the last sample
+        uint64_t _firstTimestamp = 0;       // receive time of the oldest sample in the batch
+    }; // class RTBatcher
+
+    /// RTBatcher for channel-major batches
+    class RTColumnBatcher {
+    public:
+        typedef boost::function<void(RTColumns&)> BatchHandler;
+
+        /// \param handler      Called with every completed batch
+        /// \param maxSamples   Number of samples in a full batch
+        /// \param maxDelayUs   Maximum age of the oldest sample before a partial batch is handed over, 0 for no limit
+        RTColumnBatcher(BatchHandler handler, size_t maxSamples, uint32_t maxDelayUs)
+                : _handler(handler), _maxSamples(maxSamples > 0 ? maxSamples : 1),
+                  _maxDelay(uint64_t(maxDelayUs) * 1000) {}
+
+        /// Add the samples of one frame
+        /// \param columns      The decoded samples
+        /// \param timestamp    The current time in ns
+        void add(RTColumns &columns, uint64_t timestamp) {
+            size_t begin = 0;
+            while (begin < columns.size()) {
+                if (_batch.capacity() == 0 || _batch.channels() != columns.channels()) {
+                    flush(); // first batch, or the last one was moved away by the handler
+                    _batch.reset(columns.channels(), _maxSamples);
+                }
+                if (_batch.empty())
+                    _firstTimestamp = columns.timestamps()[begin];
+
+                begin += _batch.append(columns, begin, columns.size() - begin);
+
+                if (_batch.size() == _batch.capacity())
+                    flush();
+            }
+
+            poll(timestamp);
+        }
+
+        /// Hand over a partial batch if its oldest sample is too old
+        /// \param timestamp The current time in ns
+        void poll(uint64_t timestamp) {
+            if (!_batch.empty() && _maxDelay > 0 && timestamp >= _firstTimestamp + _maxDelay)
+                flush();
+        }
+
+        /// Hand over whatever has been accumulated
+        void flush() {
+            if (_batch.empty())
+                return;
+
+            _handler(_batch);
+            _batch.clear();
+        }
+
+    private:
+        BatchHandler _handler;              // receives the completed batches
+        size_t _maxSamples;                 // samples per full batch
+        uint64_t _maxDelay;                 // maximum age of a partial batch in ns
+        RTColumns _batch;                   // reused batch storage
+        uint64_t _firstTimestamp = 0;       // receive time of the oldest sample in the batch
+    }; // class RTColumnBatcher
+
+    /// Storage for a batch of the given number of samples shaped like a frame, e.g. to fill an ObjectPool
+    /// \param frame       The decoded samples of one frame
+    /// \param samples     Number of samples, at least those of the frame
+    template<typename T>
+    std::vector<RTData<T>> batchStorage(const std::vector<RTData<T>> &frame, size_t samples) {
+        if (frame.empty())
+            return frame;
+        return std::vector<RTData<T>>(std::max(samples, frame.size()), frame.front());
+    }
+
+    /// batchStorage for channel-major batches
+    inline RTColumns batchStorage(const RTColumns &columns, size_t samples) {
+        return RTColumns(columns.channels(), std::max(samples, columns.capacity()));
+    }
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_BATCHER_HPP
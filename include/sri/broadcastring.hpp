@@ -0,0 +1,226 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_BROADCASTRING_HPP
+#define SRI_FTSENSOR_SDK_BROADCASTRING_HPP
+
+#include <sri/seqlock.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace SRI {
+    /// Single-producer broadcast ring. Every entry is written once and can be read by any number of
+    /// subscribers, each with its own cursor, so a slow subscriber never delays the others.
+    /// \tparam T Trivially copyable entry type
+    template<typename T>
+    class BroadcastRing {
+    public:
+        /// What happens when a subscriber falls a whole ring behind
+        enum class Policy {
+            Block,     // The producer waits for this subscriber. Use it for recorders that must not lose data.
+            Overwrite  // The subscriber skips to the oldest entry still in the ring and counts the lost ones.
+        };
+
+        class Subscriber {
+        public:
+            /// Take the next entry. If the producer is overwriting the slot of a published entry, poll waits
+            /// for that write instead of reporting no entry, then skips to the oldest entry still in the ring.
+            /// \param[out] value The entry
+            /// \return           false if there is no new entry
+            bool poll(T &value) {
+                uint64_t cursor = _cursor.load(std::memory_order_relaxed);
+                for (;;) {
+                    Entry entry;
+                    if (!_ring->slot(cursor).tryLoad(entry)) {
+                        if (_ring->_head.load(std::memory_order_acquire) < cursor) {
+                            return false; // the next entry is just being published
+                        }
+                        std::this_thread::yield(); // lapped while the slot is overwritten
+                        continue;
+                    }
+                    if (entry.Sequence < cursor) {
+                        return false; // not published yet
+                    }
+                    if (entry.Sequence > cursor) { // lapped by the producer
+                        uint64_t head = _ring->_head.load(std::memory_order_acquire);
+                        uint64_t oldest = head >= _ring->_capacity ? head - _ring->_capacity + 2 : 1;
+                        oldest = std::max(oldest, cursor + 1);
+                        _lost.fetch_add(oldest - cursor, std::memory_order_relaxed);
+                        cursor = oldest;
+                        _cursor.store(cursor, std::memory_order_release);
+                        continue;
+                    }
+
+                    value = entry.Value;
+                    _cursor.store(cursor + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+
+            /// Take up to n entries
+            /// \param[out] values The entries
+            /// \param[in]  n      The capacity of values
+            /// \return            The number of entries taken
+            size_t poll(T *values, size_t n) {
+                size_t i = 0;
+                while (i < n && poll(values[i])) {
+                    i++;
+                }
+                return i;
+            }
+
+            /// Number of entries published but not yet taken
+            uint64_t pending() const {
+                uint64_t head = _ring->_head.load(std::memory_order_acquire);
+                uint64_t cursor = _cursor.load(std::memory_order_acquire);
+                return head + 1 > cursor ? head + 1 - cursor : 0;
+            }
+
+            /// Number of entries skipped because the subscriber was lapped
+            uint64_t lost() const {
+                return _lost.load(std::memory_order_relaxed);
+            }
+
+            Policy policy() const {
+                return _policy;
+            }
+
+            Subscriber(BroadcastRing *ring, Policy policy, uint64_t cursor)
+                    : _ring(ring), _policy(policy), _cursor(cursor), _lost(0), _subscribed(true) {}
+
+        private:
+            friend class BroadcastRing;
+
+            BroadcastRing *_ring;               // the ring must outlive its subscribers
+            Policy _policy;                     // overflow policy of this subscriber
+            std::atomic<uint64_t> _cursor;      // sequence of the next entry to take
+            std::atomic<uint64_t> _lost;        // entries skipped after being lapped
+            std::atomic<bool> _subscribed;      // cleared on unsubscribe to release a blocked producer
+        }; // class Subscriber
+
+        typedef std::shared_ptr<Subscriber> SubscriberPtr;
+
+        /// \param capacity Number of entries kept in the ring, rounded up to a power of two
+        explicit BroadcastRing(size_t capacity = 1024)
+                : _head(0), _blocking(std::make_shared<SubscriberList>()), _generation(0),
+                  _producerBlocking(_blocking), _producerGeneration(0) {
+            _capacity = 1;
+            while (_capacity < capacity) {
+                _capacity <<= 1;
+            }
+            _slots.reset(new SeqLock<Entry>[_capacity]);
+        }
+
+        BroadcastRing(const BroadcastRing &) = delete;
+        BroadcastRing &operator=(const BroadcastRing &) = delete;
+
+        /// Add a subscriber that starts with the next published entry
+        /// \param policy The overflow policy of the subscriber
+        /// \return       The subscriber, call poll() on it from the consuming thread
+        SubscriberPtr subscribe(Policy policy = Policy::Overwrite) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            SubscriberPtr sub = std::make_shared<Subscriber>(this, policy,
+                                                             _head.load(std::memory_order_acquire) + 1);
+            if (policy == Policy::Block) {
+                std::shared_ptr<SubscriberList> blocking = std::make_shared<SubscriberList>(*std::atomic_load(&_blocking));
+                blocking->push_back(sub);
+                std::atomic_store(&_blocking, blocking);
+                _generation.fetch_add(1, std::memory_order_release);
+            }
+            return sub;
+        }
+
+        /// Remove a subscriber. A producer waiting for it is released.
+        void unsubscribe(const SubscriberPtr &sub) {
+            if (!sub)
+                return;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            sub->_subscribed.store(false, std::memory_order_release);
+            if (sub->_policy == Policy::Block) {
+                std::shared_ptr<SubscriberList> blocking = std::make_shared<SubscriberList>(*std::atomic_load(&_blocking));
+                blocking->erase(std::remove(blocking->begin(), blocking->end(), sub), blocking->end());
+                std::atomic_store(&_blocking, blocking);
+                _generation.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        /// Publish an entry. Must only be called from one thread.
+        /// Waits only while a Block subscriber is a whole ring behind.
+        void publish(const T &value) {
+            uint64_t seq = _head.load(std::memory_order_relaxed) + 1;
+
+            // the list is reloaded only after subscribe or unsubscribe, atomic_load on a shared_ptr takes a lock
+            uint64_t generation = _generation.load(std::memory_order_acquire);
+            if (generation != _producerGeneration) {
+                _producerBlocking = std::atomic_load(&_blocking);
+                _producerGeneration = generation;
+            }
+            for (auto &sub : *_producerBlocking) {
+                while (seq - sub->_cursor.load(std::memory_order_acquire) >= _capacity &&
+                       sub->_subscribed.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            Entry entry;
+            entry.Sequence = seq;
+            entry.Value = value;
+            slot(seq).store(entry);
+            _head.store(seq, std::memory_order_release);
+        }
+
+        /// Number of entries published so far
+        uint64_t published() const {
+            return _head.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const {
+            return _capacity;
+        }
+
+    private:
+        struct Entry {
+            uint64_t Sequence = 0; // 0 means never written
+            T Value;
+        };
+
+        typedef std::vector<SubscriberPtr> SubscriberList;
+
+        SeqLock<Entry> &slot(uint64_t seq) {
+            return _slots[seq & (_capacity - 1)];
+        }
+
+        size_t _capacity;                               // number of slots, power of two
+        std::unique_ptr<SeqLock<Entry>[]> _slots;       // entries, each guarded by its own sequence lock
+        char _padding[64];                              // keeps _head off the cache line of the members above
+        std::atomic<uint64_t> _head;                    // sequence of the newest published entry
+        std::shared_ptr<SubscriberList> _blocking;      // Block subscribers, replaced as a whole (copy on write)
+        std::atomic<uint64_t> _generation;              // incremented whenever _blocking is replaced
+        std::shared_ptr<SubscriberList> _producerBlocking; // the producer's copy of _blocking
+        uint64_t _producerGeneration;                   // _generation of _producerBlocking
+        std::mutex _mutex;                              // serializes subscribe and unsubscribe
+    }; // class BroadcastRing
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_BROADCASTRING_HPP
@@ -0,0 +1,176 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_BUFFERPOOL_HPP
+#define SRI_FTSENSOR_SDK_BUFFERPOOL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace SRI {
+    const size_t RT_RECV_BUFFER_SIZE = 4096; // initial capacity of receive buffers
+
+    /// Byte buffer for received data. Unlike std::vector<int8_t> it grows without value-initializing
+    /// the new bytes, so the transport reads straight into reserved capacity.
+    class FrameBuffer {
+    public:
+        explicit FrameBuffer(size_t capacity = 0) {
+            reserve(capacity);
+        }
+
+        FrameBuffer(FrameBuffer &&other) noexcept
+                : _data(std::move(other._data)), _size(other._size), _capacity(other._capacity) {
+            other._size = 0;
+            other._capacity = 0;
+        }
+
+        FrameBuffer &operator=(FrameBuffer &&other) noexcept {
+            _data = std::move(other._data);
+            _size = other._size;
+            _capacity = other._capacity;
+            other._size = 0;
+            other._capacity = 0;
+            return *this;
+        }
+
+        int8_t *data() {
+            return _data.get();
+        }
+
+        const int8_t *data() const {
+            return _data.get();
+        }
+
+        size_t size() const {
+            return _size;
+        }
+
+        size_t capacity() const {
+            return _capacity;
+        }
+
+        bool empty() const {
+            return _size == 0;
+        }
+
+        int8_t &operator[](size_t i) {
+            return _data[i];
+        }
+
+        const int8_t &operator[](size_t i) const {
+            return _data[i];
+        }
+
+        int8_t &back() {
+            return _data[_size - 1];
+        }
+
+        /// Make room for n bytes, keeping the content. Grows at least by a factor of two.
+        void reserve(size_t n) {
+            if (n <= _capacity)
+                return;
+            size_t capacity = std::max(n, _capacity * 2);
+            std::unique_ptr<int8_t[]> data(new int8_t[capacity]); // not value-initialized
+            if (_size > 0)
+                std::memcpy(data.get(), _data.get(), _size);
+            _data = std::move(data);
+            _capacity = capacity;
+        }
+
+        /// Set the size, new bytes are left uninitialized
+        void resize(size_t n) {
+            reserve(n);
+            _size = n;
+        }
+
+        void clear() {
+            _size = 0;
+        }
+
+        /// Remove the first n bytes and move the rest to the front
+        void consume(size_t n) {
+            if (n >= _size) {
+                _size = 0;
+                return;
+            }
+            std::memmove(_data.get(), _data.get() + n, _size - n);
+            _size -= n;
+        }
+
+    private:
+        std::unique_ptr<int8_t[]> _data;
+        size_t _size = 0;
+        size_t _capacity = 0;
+    }; // class FrameBuffer
+
+    /// Free list of reusable objects, e.g. decoded frames handed between the receiving and the dispatching thread.
+    /// Objects are moved in and out, so their heap storage is kept. Neither side allocates once the pool is warm.
+    /// \tparam T A movable type
+    template<typename T>
+    class ObjectPool {
+    public:
+        /// \param maxObjects Maximum number of pooled objects, further released objects are destroyed
+        explicit ObjectPool(size_t maxObjects = 16) : _maxObjects(maxObjects) {
+            _objects.reserve(maxObjects);
+        }
+
+        /// Take a pooled object
+        /// \param[out] object  Assigned the pooled object
+        /// \return             false if the pool is empty and object is unchanged
+        bool acquire(T &object) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_objects.empty())
+                return false;
+            object = std::move(_objects.back());
+            _objects.pop_back();
+            return true;
+        }
+
+        /// Fill the pool up to its capacity with copies of an object, so that objects of its shape
+        /// can be acquired later without allocating
+        void fill(const T &prototype) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            while (_objects.size() < _maxObjects) {
+                _objects.push_back(prototype);
+            }
+        }
+
+        /// Return an object for reuse
+        void release(T &&object) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_objects.size() < _maxObjects)
+                _objects.push_back(std::move(object));
+        }
+
+        size_t size() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _objects.size();
+        }
+
+    private:
+        size_t _maxObjects;         // capacity reserved for _objects
+        std::vector<T> _objects;    // pooled objects
+        std::mutex _mutex;
+    }; // class ObjectPool
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_BUFFERPOOL_HPP
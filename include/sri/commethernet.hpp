@@ -24,13 +24,36 @@ Shenyang Institute of Automation, Chinese Academy of Sciences.
 #ifndef SRI_FTSENSOR_SDK_COMMETHERNET_HPP
 #define SRI_FTSENSOR_SDK_COMMETHERNET_HPP
 
+#include <sri/config.hpp>
 #include <sri/sensorcomm.hpp>
+#include <sri/logger.hpp>
+#include <sri/types.hpp> // before asio, whose termios.h defines macros named like CanRate's members
 #include <boost/asio.hpp>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace SRI {
     using namespace boost::asio;
 
+    /// Socket tuning and connection handling of CommEthernet, applied by initialize() before connecting.
+    /// Options the platform does not support are skipped with a warning.
+    struct SocketOptions {
+        bool NoDelay = true;        // TCP_NODELAY, commands are sent without waiting for Nagle's algorithm
+        int ReceiveBuffer = 0;      // SO_RCVBUF in bytes, 0 for the system default
+        int BusyPoll = 0;           // SO_BUSY_POLL in us, 0 for off (Linux, may need CAP_NET_ADMIN)
+        bool QuickAck = false;      // TCP_QUICKACK, re-armed after every read since the kernel clears it (Linux)
+        bool RxTimestamps = false;  // SO_TIMESTAMPING software receive timestamps, see getReceiveTimestamp (Linux)
+        uint32_t ConnectTimeoutMs = 3000;   // a connect gives up after this, 0 waits as long as the system does
+        bool HotStandby = false;    // keep a second connection ready in the background for reconnect(), only
+                                    // for sensors accepting two connections at once: the M8128 serves a single one,
+                                    // so leave it off there. Given up if the sensor refuses the second connection
+    };
+
     class CommEthernet : public SensorComm {
     public:
 //        typedef ip::tcp::acceptor acceptor_type;
@@ -39,7 +62,9 @@ namespace SRI {
         typedef ip::address       address_type;
 
     public:
-        CommEthernet(std::string ip = "192.168.1.108", uint16_t port = 4008) : _socket(_io) {
+        CommEthernet(std::string ip = "192.168.1.108", uint16_t port = 4008,
+                     const SocketOptions &options = SocketOptions())
+                : _socket(_io), _timer(_io), _options(options), _standby(_io) {
             _ip = _ip.from_string(ip);
             _port = port;
             _endpoint.address(_ip);
@@ -47,47 +72,48 @@ namespace SRI {
         }
 
         ~CommEthernet() override {
-
+            if (_standbyThread.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(_standbyMutex);
+                    _stopping = true;
+                }
+                _standbyWake.notify_one();
+                _standbyThread.join(); // within ConnectTimeoutMs if a connect is in progress
+            }
+            if (_ioThread.joinable()) {
+                _work.reset();
+                _io.stop();
+                _ioThread.join();
+            }
         }
 
         bool isValid() override {
             return _validStatus;
         }
 
-        bool initialize() override {
-            try {
-                _socket.connect(_endpoint); // connect to endpoint
-                _validStatus = true;
-            }
-            catch (boost::system::system_error &error) {
-                std::cout << "SRI::ETHERNET::Error connecting to sensors: " << error.what() << std::endl;
-                _validStatus = false;
-            }
+        /// Connect, closing the previous connection if any. Gives up after SocketOptions::ConnectTimeoutMs
+        /// and starts keeping a standby connection with SocketOptions::HotStandby.
+        /// Once asynchronous transactions are used, the socket is replaced on the event loop thread.
+        SRI_FTSENSOR_SDK_DECL bool initialize() override;
 
-            return _validStatus;
-        }
+        /// Replace a lost connection, by the standby connection if one is ready, otherwise by connecting.
+        /// A running asynchronous transaction fails, the queued ones use the new connection.
+        SRI_FTSENSOR_SDK_DECL bool reconnect() override;
 
         size_t write(std::vector<int8_t> &buf) override {
-            if (!_validStatus) {
-                return 0;
-            }
-            return _socket.write_some(buffer(buf));
+            return send(buffer(buf));
         }
 
         size_t write(const std::string &buf) override {
-            if (!_validStatus) {
-                return 0;
-            }
-            return _socket.write_some(buffer(&buf[0], buf.size()));
+            return send(buffer(&buf[0], buf.size()));
         }
 
         size_t write(char *buf, size_t n) override {
-            if (!_validStatus) {
-                return 0;
-            }
-            return _socket.write_some(buffer(buf, n));
+            return send(buffer(buf, n));
         }
 
+        using SensorComm::read;
+
         size_t read(std::vector<int8_t> &buf) override {
             if (!_validStatus) {
                 return 0;
@@ -95,7 +121,7 @@ namespace SRI {
 
             buf.resize(available());
 
-            return _socket.read_some(buffer(buf));
+            return receive(buffer(buf));
         }
 
         size_t read(char *buf, size_t n) override {
@@ -104,8 +130,13 @@ namespace SRI {
             }
 
             size_t num = n < available() ? n : available();
-
-            return _socket.read_some(buffer(buf, num));
+#ifdef __linux__
+            if (_rxTimestamps && num > 0)
+                return receiveWithTimestamp(buf, num);
+#endif
+            size_t received = receive(buffer(buf, num));
+            rearmQuickAck();
+            return received;
         }
 
         size_t read(std::string &buf) override {
@@ -115,26 +146,132 @@ namespace SRI {
 
             buf.resize(available());
 
-            return _socket.read_some(buffer(&buf[0], buf.size()));
+            return receive(buffer(&buf[0], buf.size()));
+        }
+
+        /// Bytes ready to be read. A connection closed by the sensor is detected here and invalidates the
+        /// communication, so waiting loops end and reconnect() can replace it. To keep empty polls cheap, this
+        /// is checked every PEER_CHECK_POLLS polls without data; reads and writes fail on a closed one anyway.
+        SRI_FTSENSOR_SDK_DECL size_t available() override;
+
+        /// Kernel receive time of the data returned by the last read(char*, size_t), converted to the
+        /// steady clock. With several TCP segments in one read, the time of the last one is reported.
+        uint64_t getReceiveTimestamp() override {
+            return _rxTimestamp;
         }
 
-        size_t available() override {
-            return _socket.available();
+        /// Replace the socket options, effective with the next initialize()
+        void setSocketOptions(const SocketOptions &options) {
+            _options = options;
         }
 
+        const SocketOptions &getSocketOptions() const {
+            return _options;
+        }
+
+        /// Send a command and receive its response line on the event loop thread, started by the first call
+        SRI_FTSENSOR_SDK_DECL void asyncTransact(const std::string &command, uint32_t timeoutMs,
+                                                 ResponseHandler handler) override;
+
         std::string getRemoteAddress() {
             return _socket.remote_endpoint().address().to_string();
         }
 
     private:
+        static const unsigned PEER_CHECK_POLLS = 64; // empty polls of available() between checks for a closed peer
+
+        SRI_FTSENSOR_SDK_DECL bool openConnection();
+
+        /// Run a task replacing the socket on the event loop thread, or right away if the loop is not started
+        /// or this is the event loop thread, so no transaction uses the socket meanwhile
+        SRI_FTSENSOR_SDK_DECL bool onEventLoop(const boost::function<bool()> &task);
+
+        /// Open a socket, apply the options and connect it within ConnectTimeoutMs. Runs on a private io_service,
+        /// so neither the event loop nor the active connection are involved.
+        /// \param[out] handle        The connected socket, owned by the caller
+        /// \param[out] rxTimestamps  SO_TIMESTAMPING is active on it
+        /// \param[out] error         Why connecting failed
+        SRI_FTSENSOR_SDK_DECL bool connectSocket(socket_type::native_handle_type &handle, bool &rxTimestamps,
+                                                 boost::system::error_code &error);
+
+        /// Keep a connected standby socket until the destructor, replaced whenever reconnect() takes it
+        SRI_FTSENSOR_SDK_DECL void startStandby();
+
+        /// Move the standby connection to the active socket if it is still open on the sensor's side
+        SRI_FTSENSOR_SDK_DECL bool takeStandby();
+
+        /// Whether the sensor closed the connection, without consuming data
+        SRI_FTSENSOR_SDK_DECL static bool peerClosed(socket_type::native_handle_type handle);
+
+        SRI_FTSENSOR_SDK_DECL void connectionLost(const boost::system::error_code &error);
+
+        SRI_FTSENSOR_SDK_DECL size_t send(const const_buffer &data);
+
+        SRI_FTSENSOR_SDK_DECL size_t receive(const mutable_buffer &data);
+
+        /// \return SO_TIMESTAMPING is active
+        SRI_FTSENSOR_SDK_DECL bool applySocketOptions(socket_type &socket);
+
+        SRI_FTSENSOR_SDK_DECL void rearmQuickAck();
+
+#ifdef __linux__
+        SRI_FTSENSOR_SDK_DECL static bool setOption(int handle, int level, int name, int value,
+                                                    const char *optionName);
+
+        /// Read with recvmsg to get the SCM_TIMESTAMPING control message along with the data
+        SRI_FTSENSOR_SDK_DECL size_t receiveWithTimestamp(char *buf, size_t n);
+
+        /// Software timestamps are CLOCK_REALTIME, shift them by the current offset to the steady clock
+        SRI_FTSENSOR_SDK_DECL static uint64_t toSteadyClock(const timespec &kernelTime);
+#endif
+
+        struct Transaction {
+            std::string Command;
+            std::string Echo;           // start of the expected response, e.g. ACK+SMPR=, empty to accept any
+            uint32_t Timeout = 0;       // in ms
+            ResponseHandler Handler;
+            bool Done = false;          // the response has been received or the transaction failed
+        };
+
+        SRI_FTSENSOR_SDK_DECL void startEventLoop();
+
+        /// Run the oldest transaction, on the event loop thread only
+        SRI_FTSENSOR_SDK_DECL void startTransaction();
+
+        /// Read the response line of the running transaction. Lines not echoing its command are late
+        /// responses of timed out transactions and are dropped, so they do not shift later transactions.
+        SRI_FTSENSOR_SDK_DECL void readResponse(const std::shared_ptr<Transaction> &transaction);
+
+        SRI_FTSENSOR_SDK_DECL void finishTransaction(bool ok, size_t n);
+
         io_service _io;             // asio must have an io_service object
         endpoint_type _endpoint;    // connected endpoint
         socket_type   _socket;      // socket object
         address_type  _ip;          // ip address
         uint16_t      _port;        // port number
+        steady_timer  _timer;       // timeout of the running transaction
+        streambuf     _response;    // received data of asynchronous transactions
+        std::deque<std::shared_ptr<Transaction>> _transactions; // queued transactions, event loop thread only
+        std::unique_ptr<io_service::work> _work; // keeps the event loop running
+        std::thread   _ioThread;    // runs the event loop
+        std::mutex    _ioMutex;     // guards starting the event loop
+        SocketOptions _options;     // applied when the socket is opened
+        unsigned      _emptyPolls = 0;       // available() returned 0 this many times in a row
+        bool          _rxTimestamps = false; // SO_TIMESTAMPING is active
+        uint64_t      _rxTimestamp = 0;      // steady clock time in ns of the last read, 0 if unknown
+        socket_type   _standby;     // connected standby socket, see SocketOptions::HotStandby
+        bool          _standbyRxTimestamps = false; // SO_TIMESTAMPING is active on _standby
+        bool          _stopping = false;     // the standby thread has to end
+        std::thread   _standbyThread;        // keeps _standby connected
+        std::mutex    _standbyMutex;         // guards _standby and _stopping
+        std::condition_variable _standbyWake; // wakes the standby thread
 
     };
 } //namespace SRI
 
 
+#ifndef SRI_FTSENSOR_SDK_SEPARATE_COMPILATION
+#include <sri/impl/commethernet.ipp>
+#endif
+
 #endif //SRI_FTSENSOR_SDK_COMMETHERNET_HPP
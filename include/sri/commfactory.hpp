@@ -0,0 +1,41 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_COMMFACTORY_HPP
+#define SRI_FTSENSOR_SDK_COMMFACTORY_HPP
+
+#include <sri/config.hpp>
+#include <sri/sensorcomm.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace SRI {
+    /// Connect to a tcp-type FTSensor without including Boost.Asio. Linked against sri_ftsensor,
+    /// the transport is compiled in the library only.
+    /// \param ip   The IP address of the sensor
+    /// \param port The port of the sensor
+    /// \return     A CommEthernet, owned by the FTSensor it is handed to
+    SRI_FTSENSOR_SDK_DECL SensorComm *createCommEthernet(const std::string &ip = "192.168.1.108", uint16_t port = 4008);
+} //namespace SRI
+
+#ifndef SRI_FTSENSOR_SDK_SEPARATE_COMPILATION
+#include <sri/impl/commfactory.ipp>
+#endif
+
+
+#endif //SRI_FTSENSOR_SDK_COMMFACTORY_HPP
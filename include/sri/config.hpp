@@ -0,0 +1,33 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_CONFIG_HPP
+#define SRI_FTSENSOR_SDK_CONFIG_HPP
+
+// The SDK is header-only by default. Linking the CMake target sri_ftsensor defines
+// SRI_FTSENSOR_SDK_SEPARATE_COMPILATION: the parser, the commands, the Ethernet transport
+// and the real time templates for float and uint16_t are then compiled once in src/ftsensor.cpp
+// from the include/sri/impl/*.ipp files, which the headers only include in header-only use.
+// CommEthernet keeps boost/asio.hpp in its header, its members are asio objects.
+#ifdef SRI_FTSENSOR_SDK_SEPARATE_COMPILATION
+#define SRI_FTSENSOR_SDK_DECL
+#else
+#define SRI_FTSENSOR_SDK_DECL inline
+#endif
+
+
+#endif //SRI_FTSENSOR_SDK_CONFIG_HPP
@@ -0,0 +1,254 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_COROUTINE_HPP
+#define SRI_FTSENSOR_SDK_COROUTINE_HPP
+
+// Optional C++20 layer, enabled with the CMake option SRI_FTSENSOR_SDK_COROUTINES.
+// The rest of the SDK stays C++11.
+#if !defined(__cpp_impl_coroutine) && !defined(__cpp_coroutines)
+#error "sri/coroutine.hpp needs C++20 coroutines, configure with -DSRI_FTSENSOR_SDK_COROUTINES=ON"
+#endif
+
+#include <utility> // std::exchange, missing in boost/asio/awaitable.hpp of Boost 1.74
+#include <sri/ftsensor.hpp>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/use_awaitable.hpp>
+
+namespace SRI {
+    namespace detail {
+        /// Type-erased, move-only completion handler of an asynchronous operation with result R.
+        /// complete() runs the handler on its associated executor, e.g. the executor of the awaiting coroutine.
+        template<typename R>
+        class Completion {
+        public:
+            template<typename Handler>
+            explicit Completion(Handler &&handler)
+                    : _impl(std::make_unique<Impl<std::decay_t<Handler>>>(std::forward<Handler>(handler))) {}
+
+            void complete(R result) {
+                _impl->complete(std::move(result));
+            }
+
+        private:
+            struct Base {
+                virtual ~Base() = default;
+                virtual void complete(R result) = 0;
+            };
+
+            template<typename Handler>
+            struct Impl : Base {
+                explicit Impl(Handler &&h) : handler(std::move(h)) {}
+
+                void complete(R result) override {
+                    auto executor = boost::asio::get_associated_executor(handler);
+                    boost::asio::post(executor, [h = std::move(handler), r = std::move(result)]() mutable {
+                        h(std::move(r));
+                    });
+                }
+
+                Handler handler;
+            };
+
+            std::unique_ptr<Base> _impl;
+        }; // class Completion
+
+        /// Await one of the handler based asyncGet* queries of FTSensor
+        template<typename R, typename Start>
+        boost::asio::awaitable<R> awaitQuery(Start start) {
+            return boost::asio::async_initiate<const boost::asio::use_awaitable_t<> &, void(R)>(
+                    [start](auto handler) {
+                        // boost::function needs a copyable handler
+                        auto completion = std::make_shared<Completion<R>>(std::move(handler));
+                        start([completion](bool, const R &value) { completion->complete(value); });
+                    }, boost::asio::use_awaitable);
+        }
+    } //namespace detail
+
+    /// Batches of the GSD stream, awaited one after another:
+    ///     RTColumns batch;
+    ///     while (co_await stream->next(batch)) { ... }
+    /// Batches arriving while the consumer is busy are queued up to a capacity, then the oldest is dropped,
+    /// so the receiving thread never waits for the coroutine.
+    class RTBatchStream : public std::enable_shared_from_this<RTBatchStream> {
+    public:
+        explicit RTBatchStream(size_t capacity) : _capacity(capacity > 0 ? capacity : 1) {}
+
+        /// Wait for the next batch
+        /// \param[out] batch  The batch
+        /// \return            false once the stream has been stopped and drained
+        boost::asio::awaitable<bool> next(RTColumns &batch) {
+            return boost::asio::async_initiate<const boost::asio::use_awaitable_t<> &, void(bool)>(
+                    [self = shared_from_this(), &batch](auto handler) {
+                        std::unique_lock<std::mutex> lock(self->_mutex);
+                        if (!self->_batches.empty() || self->_stopped) {
+                            bool ok = self->take(batch);
+                            lock.unlock();
+                            detail::Completion<bool>(std::move(handler)).complete(ok);
+                            return;
+                        }
+                        self->_target = &batch;
+                        self->_waiter = std::make_unique<detail::Completion<bool>>(std::move(handler));
+                    }, boost::asio::use_awaitable);
+        }
+
+        /// Batches dropped because the consumer fell behind
+        uint64_t dropped() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _dropped;
+        }
+
+        /// Hand over a batch, called by the receiving thread
+        void push(RTColumns &batch) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_stopped)
+                return;
+            if (_waiter) {
+                *_target = std::move(batch);
+                resume(lock, true);
+                return;
+            }
+            if (_batches.size() >= _capacity) {
+                _batches.pop_front();
+                _dropped++;
+            }
+            _batches.push_back(std::move(batch));
+        }
+
+        /// End the stream, next() returns false after the queued batches
+        void stop() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _stopped = true;
+            if (_waiter)
+                resume(lock, false);
+        }
+
+    private:
+        /// Take the oldest batch, with _mutex locked
+        bool take(RTColumns &batch) {
+            if (_batches.empty())
+                return false;
+            batch = std::move(_batches.front());
+            _batches.pop_front();
+            return true;
+        }
+
+        void resume(std::unique_lock<std::mutex> &lock, bool ok) {
+            std::unique_ptr<detail::Completion<bool>> waiter = std::move(_waiter);
+            _target = nullptr;
+            lock.unlock();
+            waiter->complete(ok);
+        }
+
+        size_t _capacity;                                       // maximum number of queued batches
+        std::deque<RTColumns> _batches;                         // batches not yet awaited
+        RTColumns *_target = nullptr;                           // batch of the waiting consumer
+        std::unique_ptr<detail::Completion<bool>> _waiter;      // waiting consumer
+        bool _stopped = false;
+        uint64_t _dropped = 0;
+        std::mutex _mutex;
+    }; // class RTBatchStream
+
+    /// Coroutine interface of an FTSensor:
+    ///     SRI::AwaitableSensor sensor(ftSensor);
+    ///     SRI::SampleRate rate = co_await sensor.asyncGetSamplingRate();
+    /// Queries resume the awaiting coroutine on its executor. A failed query is logged and yields an empty value.
+    class AwaitableSensor {
+    public:
+        explicit AwaitableSensor(FTSensor &sensor) : _sensor(sensor) {}
+
+        boost::asio::awaitable<IpAddr> asyncGetIpAddress() {
+            return detail::awaitQuery<IpAddr>([this](auto h) { _sensor.asyncGetIpAddress(h); });
+        }
+
+        boost::asio::awaitable<MacAddr> asyncGetMacAddress() {
+            return detail::awaitQuery<MacAddr>([this](auto h) { _sensor.asyncGetMacAddress(h); });
+        }
+
+        boost::asio::awaitable<GateAddr> asyncGetGateWay() {
+            return detail::awaitQuery<GateAddr>([this](auto h) { _sensor.asyncGetGateWay(h); });
+        }
+
+        boost::asio::awaitable<NetMask> asyncGetNetMask() {
+            return detail::awaitQuery<NetMask>([this](auto h) { _sensor.asyncGetNetMask(h); });
+        }
+
+        boost::asio::awaitable<Gains> asyncGetChannelGains() {
+            return detail::awaitQuery<Gains>([this](auto h) { _sensor.asyncGetChannelGains(h); });
+        }
+
+        boost::asio::awaitable<SampleRate> asyncGetSamplingRate() {
+            return detail::awaitQuery<SampleRate>([this](auto h) { _sensor.asyncGetSamplingRate(h); });
+        }
+
+        boost::asio::awaitable<Voltages> asyncGetExcitationVoltages() {
+            return detail::awaitQuery<Voltages>([this](auto h) { _sensor.asyncGetExcitationVoltages(h); });
+        }
+
+        boost::asio::awaitable<Sensitivities> asyncGetSensorSensitivities() {
+            return detail::awaitQuery<Sensitivities>([this](auto h) { _sensor.asyncGetSensorSensitivities(h); });
+        }
+
+        boost::asio::awaitable<Offsets> asyncGetAmplifierZeroOffsets() {
+            return detail::awaitQuery<Offsets>([this](auto h) { _sensor.asyncGetAmplifierZeroOffsets(h); });
+        }
+
+        boost::asio::awaitable<RTDataMode> asyncGetRealTimeDataMode() {
+            return detail::awaitQuery<RTDataMode>([this](auto h) { _sensor.asyncGetRealTimeDataMode(h); });
+        }
+
+        boost::asio::awaitable<RTDataValid> asyncGetRealTimeDataValid() {
+            return detail::awaitQuery<RTDataValid>([this](auto h) { _sensor.asyncGetRealTimeDataValid(h); });
+        }
+
+        /// Start the GSD stream, the batch size follows FTSensor::setRealTimeDataBatch.
+        /// Call stopRealTimeData to end it.
+        /// \tparam T           The real time data format sent by the sensor
+        /// \param capacity     Number of batches queued for a busy consumer before the oldest is dropped
+        template<typename T>
+        std::shared_ptr<RTBatchStream> streamRealTimeData(const RTDataMode &rtMode = RTDataMode(),
+                                                          const RTDataValid &rtValid = "SUM",
+                                                          size_t capacity = 16) {
+            stopRealTimeData();
+            _stream = std::make_shared<RTBatchStream>(capacity);
+            std::shared_ptr<RTBatchStream> stream = _stream;
+            _sensor.startRealTimeDataColumns<T>([stream](RTColumns &batch) { stream->push(batch); },
+                                                rtMode, rtValid);
+            return stream;
+        }
+
+        void stopRealTimeData() {
+            if (!_stream)
+                return;
+            _sensor.stopRealTimeDataRepeatedly();
+            _stream->stop();
+            _stream.reset();
+        }
+
+    private:
+        FTSensor &_sensor;
+        std::shared_ptr<RTBatchStream> _stream;     // stream of streamRealTimeData
+    }; // class AwaitableSensor
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_COROUTINE_HPP
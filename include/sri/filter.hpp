@@ -0,0 +1,460 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_FILTER_HPP
+#define SRI_FTSENSOR_SDK_FILTER_HPP
+
+#include <sri/types.hpp>
+#include <sri/rtcolumns.hpp>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace SRI {
+    const size_t RT_MAX_MEDIAN_WINDOW = 31; // largest window of MedianFilter
+    const double RT_PI = 3.14159265358979323846;
+    const size_t RT_FILTER_LANES = 4;       // channels filtered together in one SSE register
+
+    static_assert(RT_MAX_CHANNELS % RT_FILTER_LANES == 0, "Filter state is kept in whole lanes");
+
+#ifdef __SSE2__
+    /// Run a filter step over the samples of the channels c to c + 3 at once. Blocks of 4 samples are
+    /// transposed in registers, so step gets one sample of the 4 channels in x and replaces it with the output.
+    /// Channels from nChannel on repeat the last channel and their results are not stored.
+    template<typename Step>
+    inline void processFilterLane(RTColumns &columns, size_t c, size_t nChannel, Step &step) {
+        float *col[RT_FILTER_LANES];
+        for (size_t k = 0; k < RT_FILTER_LANES; k++) {
+            col[k] = columns.channel(std::min(c + k, nChannel - 1));
+        }
+        const size_t lanes = std::min(RT_FILTER_LANES, nChannel - c);
+
+        size_t i = 0;
+        for (; i + 4 <= columns.size(); i += 4) {
+            __m128 x0 = _mm_loadu_ps(col[0] + i);
+            __m128 x1 = _mm_loadu_ps(col[1] + i);
+            __m128 x2 = _mm_loadu_ps(col[2] + i);
+            __m128 x3 = _mm_loadu_ps(col[3] + i);
+            _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+            step(x0);
+            step(x1);
+            step(x2);
+            step(x3);
+            _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+            _mm_storeu_ps(col[0] + i, x0);
+            if (lanes > 1)
+                _mm_storeu_ps(col[1] + i, x1);
+            if (lanes > 2)
+                _mm_storeu_ps(col[2] + i, x2);
+            if (lanes > 3)
+                _mm_storeu_ps(col[3] + i, x3);
+        }
+        for (; i < columns.size(); i++) {
+            __m128 x = _mm_set_ps(col[3][i], col[2][i], col[1][i], col[0][i]);
+            step(x);
+            alignas(16) float y[RT_FILTER_LANES];
+            _mm_store_ps(y, x);
+            for (size_t k = 0; k < lanes; k++) {
+                col[k][i] = y[k];
+            }
+        }
+    }
+#endif
+
+    /// One stage of the host-side filter chain. Stages work in place on the decoded frames, keep their
+    /// state per channel in fixed arrays and do not allocate while processing.
+    class RTFilterStage {
+    public:
+        virtual ~RTFilterStage() = default;
+
+        /// Forget the history, called when real time data starts
+        virtual void reset() = 0;
+
+        /// Filter a block of samples in place. A stage may drop samples (decimation).
+        virtual void process(RTColumns &columns) = 0;
+    };
+
+    /// Second order IIR section in transposed direct form II, one independent state per channel.
+    /// With SSE2 the states of 4 channels are updated together.
+    class BiquadFilter : public RTFilterStage {
+    public:
+        /// \param b0, b1, b2 Feed-forward coefficients
+        /// \param a1, a2     Feedback coefficients, a0 normalized to 1
+        BiquadFilter(double b0, double b1, double b2, double a1, double a2)
+                : _b0(b0), _b1(b1), _b2(b2), _a1(a1), _a2(a2) {
+            reset();
+        }
+
+        /// Second order low-pass, Butterworth for the default q
+        /// \param cutoffHz     The -3 dB frequency
+        /// \param sampleRateHz The sampling rate (SMPR)
+        /// \param q            The quality factor
+        static BiquadFilter lowPass(double cutoffHz, double sampleRateHz, double q = 0.70710678118654752) {
+            double k = std::tan(RT_PI * cutoffHz / sampleRateHz);
+            double norm = 1.0 / (1.0 + k / q + k * k);
+            double b0 = k * k * norm;
+            return BiquadFilter(b0, 2.0 * b0, b0, 2.0 * (k * k - 1.0) * norm, (1.0 - k / q + k * k) * norm);
+        }
+
+        /// First order low-pass, as a section with b2 = a2 = 0
+        static BiquadFilter firstOrderLowPass(double cutoffHz, double sampleRateHz) {
+            double k = std::tan(RT_PI * cutoffHz / sampleRateHz);
+            double norm = 1.0 / (1.0 + k);
+            return BiquadFilter(k * norm, k * norm, 0.0, (k - 1.0) * norm, 0.0);
+        }
+
+        void reset() override {
+            _primed = false;
+            std::fill(_z1, _z1 + RT_MAX_CHANNELS, 0.0f);
+            std::fill(_z2, _z2 + RT_MAX_CHANNELS, 0.0f);
+        }
+
+        void process(RTColumns &columns) override {
+            size_t nChannel = std::min(columns.channels(), RT_MAX_CHANNELS);
+            if (columns.empty())
+                return;
+
+            if (!_primed) {
+                // start in the steady state of the first sample instead of ringing up from zero
+                double gain = (_b0 + _b1 + _b2) / (1.0 + _a1 + _a2);
+                for (size_t c = 0; c < nChannel; c++) {
+                    double x = columns(c, 0);
+                    double y = gain * x;
+                    _z2[c] = _b2 * x - _a2 * y;
+                    _z1[c] = _b1 * x - _a1 * y + _z2[c];
+                }
+                _primed = true;
+            }
+
+            const float b0 = _b0, b1 = _b1, b2 = _b2, a1 = _a1, a2 = _a2;
+#ifdef __SSE2__
+            const __m128 vb0 = _mm_set1_ps(b0), vb1 = _mm_set1_ps(b1), vb2 = _mm_set1_ps(b2);
+            const __m128 va1 = _mm_set1_ps(a1), va2 = _mm_set1_ps(a2);
+            for (size_t c = 0; c < nChannel; c += RT_FILTER_LANES) {
+                __m128 z1 = _mm_load_ps(_z1 + c);
+                __m128 z2 = _mm_load_ps(_z2 + c);
+                auto step = [&](__m128 &x) {
+                    __m128 y = _mm_add_ps(_mm_mul_ps(vb0, x), z1);
+                    z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(vb1, x), _mm_mul_ps(va1, y)), z2);
+                    z2 = _mm_sub_ps(_mm_mul_ps(vb2, x), _mm_mul_ps(va2, y));
+                    x = y;
+                };
+                processFilterLane(columns, c, nChannel, step);
+                _mm_store_ps(_z1 + c, z1);
+                _mm_store_ps(_z2 + c, z2);
+            }
+#else
+            float *col[RT_MAX_CHANNELS];
+            for (size_t c = 0; c < nChannel; c++) {
+                col[c] = columns.channel(c);
+            }
+            // channels are independent, so the inner loop runs over them with the state in contiguous arrays
+            for (size_t i = 0; i < columns.size(); i++) {
+                for (size_t c = 0; c < nChannel; c++) {
+                    float x = col[c][i];
+                    float y = b0 * x + _z1[c];
+                    _z1[c] = b1 * x - a1 * y + _z2[c];
+                    _z2[c] = b2 * x - a2 * y;
+                    col[c][i] = y;
+                }
+            }
+#endif
+        }
+
+    private:
+        double _b0, _b1, _b2, _a1, _a2;    // coefficients
+        bool _primed = false;               // state initialized from the first sample
+        alignas(16) float _z1[RT_MAX_CHANNELS]; // first delay element per channel, in lanes of 4
+        alignas(16) float _z2[RT_MAX_CHANNELS]; // second delay element per channel, in lanes of 4
+    }; // class BiquadFilter
+
+    /// Butterworth low-pass of any order as a cascade of biquad sections
+    class ButterworthLowPass : public RTFilterStage {
+    public:
+        /// \param cutoffHz     The -3 dB frequency
+        /// \param sampleRateHz The sampling rate (SMPR)
+        /// \param order        The filter order
+        ButterworthLowPass(double cutoffHz, double sampleRateHz, unsigned order = 2) {
+            if (order % 2 == 1) {
+                _sections.push_back(BiquadFilter::firstOrderLowPass(cutoffHz, sampleRateHz));
+            }
+            for (unsigned k = 0; k < order / 2; k++) {
+                double q = 1.0 / (2.0 * std::cos(RT_PI * (2 * k + 1 + order % 2) / (2.0 * order)));
+                _sections.push_back(BiquadFilter::lowPass(cutoffHz, sampleRateHz, q));
+            }
+        }
+
+        void reset() override {
+            for (auto &section : _sections) {
+                section.reset();
+            }
+        }
+
+        void process(RTColumns &columns) override {
+            for (auto &section : _sections) {
+                section.process(columns);
+            }
+        }
+
+    private:
+        std::vector<BiquadFilter> _sections; // cascaded sections
+    }; // class ButterworthLowPass
+
+    /// Moving average over the last N samples of each channel. The running sums are kept in double and
+    /// recomputed from the history once per window, so rounding errors cannot pile up on long streams.
+    /// With SSE2 4 channels are averaged together.
+    class MovingAverageFilter : public RTFilterStage {
+    public:
+        /// \param window Number of samples averaged
+        explicit MovingAverageFilter(size_t window)
+                : _window(std::max<size_t>(window, 1)), _history(_window * RT_MAX_CHANNELS) {
+            reset();
+        }
+
+        void reset() override {
+            _primed = false;
+            _pos = 0;
+            std::fill(_sum, _sum + RT_MAX_CHANNELS, 0.0);
+            std::fill(_history.begin(), _history.end(), 0.0f);
+        }
+
+        void process(RTColumns &columns) override {
+            size_t nChannel = std::min(columns.channels(), RT_MAX_CHANNELS);
+            if (columns.empty())
+                return;
+
+            if (!_primed) {
+                for (size_t c = 0; c < nChannel; c++) {
+                    for (size_t k = 0; k < _window; k++) {
+                        _history[k * RT_MAX_CHANNELS + c] = columns(c, 0);
+                    }
+                    _sum[c] = double(columns(c, 0)) * _window;
+                }
+                _primed = true;
+            }
+
+            const double scale = 1.0 / double(_window);
+#ifdef __SSE2__
+            const __m128d vscale = _mm_set1_pd(scale);
+            for (size_t c = 0; c < nChannel; c += RT_FILTER_LANES) {
+                __m128d sumLow = _mm_load_pd(_sum + c);      // channels c, c + 1
+                __m128d sumHigh = _mm_load_pd(_sum + c + 2); // channels c + 2, c + 3
+                size_t pos = _pos;
+                auto step = [&](__m128 &x) {
+                    float *history = &_history[pos * RT_MAX_CHANNELS + c];
+                    __m128 oldest = _mm_loadu_ps(history);
+                    _mm_storeu_ps(history, x);
+                    sumLow = _mm_add_pd(sumLow, _mm_sub_pd(_mm_cvtps_pd(x), _mm_cvtps_pd(oldest)));
+                    sumHigh = _mm_add_pd(sumHigh, _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)),
+                                                             _mm_cvtps_pd(_mm_movehl_ps(oldest, oldest))));
+                    pos = pos + 1 == _window ? 0 : pos + 1;
+                    if (pos == 0) {
+                        sumLow = sumHigh = _mm_setzero_pd();
+                        for (size_t k = 0; k < _window; k++) {
+                            __m128 h = _mm_loadu_ps(&_history[k * RT_MAX_CHANNELS + c]);
+                            sumLow = _mm_add_pd(sumLow, _mm_cvtps_pd(h));
+                            sumHigh = _mm_add_pd(sumHigh, _mm_cvtps_pd(_mm_movehl_ps(h, h)));
+                        }
+                    }
+                    x = _mm_movelh_ps(_mm_cvtpd_ps(_mm_mul_pd(sumLow, vscale)),
+                                      _mm_cvtpd_ps(_mm_mul_pd(sumHigh, vscale)));
+                };
+                processFilterLane(columns, c, nChannel, step);
+                _mm_store_pd(_sum + c, sumLow);
+                _mm_store_pd(_sum + c + 2, sumHigh);
+            }
+#else
+            for (size_t c = 0; c < nChannel; c++) {
+                float *col = columns.channel(c);
+                double sum = _sum[c];
+                size_t pos = _pos;
+                for (size_t i = 0; i < columns.size(); i++) {
+                    float &oldest = _history[pos * RT_MAX_CHANNELS + c];
+                    sum += double(col[i]) - double(oldest);
+                    oldest = col[i];
+                    pos = pos + 1 == _window ? 0 : pos + 1;
+                    if (pos == 0) {
+                        sum = 0.0;
+                        for (size_t k = 0; k < _window; k++) {
+                            sum += _history[k * RT_MAX_CHANNELS + c];
+                        }
+                    }
+                    col[i] = static_cast<float>(sum * scale);
+                }
+                _sum[c] = sum;
+            }
+#endif
+            _pos = (_pos + columns.size()) % _window;
+        }
+
+    private:
+        size_t _window;                     // number of samples averaged
+        std::vector<float> _history;        // last _window samples, RT_MAX_CHANNELS per position, allocated once
+        alignas(16) double _sum[RT_MAX_CHANNELS]; // running sum per channel
+        size_t _pos = 0;                    // oldest history entry
+        bool _primed = false;               // history filled with the first sample
+    }; // class MovingAverageFilter
+
+    /// Median of the last N samples of each channel, removes single-sample spikes.
+    /// With SSE2 4 channels are sorted together by a min/max network.
+    class MedianFilter : public RTFilterStage {
+    public:
+        /// \param window Number of samples, odd, at most RT_MAX_MEDIAN_WINDOW
+        explicit MedianFilter(size_t window = 3)
+                : _window(std::min(std::max<size_t>(window | 1, 1), RT_MAX_MEDIAN_WINDOW)),
+                  _history(_window * RT_MAX_CHANNELS) {
+            reset();
+        }
+
+        void reset() override {
+            _primed = false;
+            _pos = 0;
+            std::fill(_history.begin(), _history.end(), 0.0f);
+        }
+
+        void process(RTColumns &columns) override {
+            size_t nChannel = std::min(columns.channels(), RT_MAX_CHANNELS);
+            if (columns.empty())
+                return;
+
+            if (!_primed) {
+                for (size_t c = 0; c < nChannel; c++) {
+                    for (size_t k = 0; k < _window; k++) {
+                        _history[k * RT_MAX_CHANNELS + c] = columns(c, 0);
+                    }
+                }
+                _primed = true;
+            }
+
+            const size_t middle = _window / 2;
+#ifdef __SSE2__
+            for (size_t c = 0; c < nChannel; c += RT_FILTER_LANES) {
+                size_t pos = _pos;
+                auto step = [&](__m128 &x) {
+                    _mm_storeu_ps(&_history[pos * RT_MAX_CHANNELS + c], x);
+                    pos = pos + 1 == _window ? 0 : pos + 1;
+                    __m128 v[RT_MAX_MEDIAN_WINDOW];
+                    for (size_t k = 0; k < _window; k++) {
+                        v[k] = _mm_loadu_ps(&_history[k * RT_MAX_CHANNELS + c]);
+                    }
+                    // every pass moves the largest remaining value up, the median is the last one moved
+                    for (size_t pass = 0; pass <= middle; pass++) {
+                        for (size_t k = 0; k + 1 < _window - pass; k++) {
+                            __m128 low = _mm_min_ps(v[k], v[k + 1]);
+                            v[k + 1] = _mm_max_ps(v[k], v[k + 1]);
+                            v[k] = low;
+                        }
+                    }
+                    x = v[middle];
+                };
+                processFilterLane(columns, c, nChannel, step);
+            }
+#else
+            float sorted[RT_MAX_MEDIAN_WINDOW];
+            for (size_t c = 0; c < nChannel; c++) {
+                float *col = columns.channel(c);
+                size_t pos = _pos;
+                for (size_t i = 0; i < columns.size(); i++) {
+                    _history[pos * RT_MAX_CHANNELS + c] = col[i];
+                    pos = pos + 1 == _window ? 0 : pos + 1;
+                    for (size_t k = 0; k < _window; k++) {
+                        sorted[k] = _history[k * RT_MAX_CHANNELS + c];
+                    }
+                    std::nth_element(sorted, sorted + middle, sorted + _window);
+                    col[i] = sorted[middle];
+                }
+            }
+#endif
+            _pos = (_pos + columns.size()) % _window;
+        }
+
+    private:
+        size_t _window;                     // number of samples, odd
+        std::vector<float> _history;        // last _window samples, RT_MAX_CHANNELS per position, allocated once
+        size_t _pos = 0;                    // oldest history entry
+        bool _primed = false;               // history filled with the first sample
+    }; // class MedianFilter
+
+    /// Keeps every factor-th sample. Put a low-pass in front of it against aliasing.
+    class Decimator : public RTFilterStage {
+    public:
+        explicit Decimator(size_t factor) : _factor(std::max<size_t>(factor, 1)) {}
+
+        void reset() override {
+            _phase = 0;
+        }
+
+        void process(RTColumns &columns) override {
+            size_t kept = 0;
+            for (size_t i = 0; i < columns.size(); i++) {
+                if (_phase == 0) {
+                    for (size_t c = 0; c < columns.channels(); c++) {
+                        columns(c, kept) = columns(c, i);
+                    }
+                    columns.timestamps()[kept] = columns.timestamps()[i];
+                    kept++;
+                }
+                _phase = _phase + 1 == _factor ? 0 : _phase + 1;
+            }
+            columns.resize(kept);
+        }
+
+    private:
+        size_t _factor;     // keep one of _factor samples
+        size_t _phase = 0;  // samples until the next kept one
+    }; // class Decimator
+
+    /// Ordered list of filter stages applied to real time data in the receiving thread
+    class RTFilterChain {
+    public:
+        /// Append a stage, e.g. chain.add(std::make_shared<SRI::MedianFilter>(3))
+        RTFilterChain &add(std::shared_ptr<RTFilterStage> stage) {
+            _stages.push_back(stage);
+            return *this;
+        }
+
+        void reset() {
+            for (auto &stage : _stages) {
+                stage->reset();
+            }
+        }
+
+        void process(RTColumns &columns) {
+            for (auto &stage : _stages) {
+                if (columns.empty())
+                    return;
+                stage->process(columns);
+            }
+        }
+
+        bool empty() const {
+            return _stages.empty();
+        }
+
+    private:
+        std::vector<std::shared_ptr<RTFilterStage>> _stages; // applied in order
+    }; // class RTFilterChain
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_FILTER_HPP
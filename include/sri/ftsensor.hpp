@@ -25,800 +25,1086 @@ Shenyang Institute of Automation, Chinese Academy of Sciences.
 #ifndef SRI_FTSENSOR_SDK_SRI_SENSOR_H
 #define SRI_FTSENSOR_SDK_SRI_SENSOR_H
 
+#include <sri/config.hpp>
 #include <sri/sensorcomm.hpp>
+#include <sri/bufferpool.hpp>
 #include <sri/types.hpp>
+#include <sri/responseparser.hpp>
+#include <sri/logger.hpp>
+#include <sri/seqlock.hpp>
+#include <sri/broadcastring.hpp>
+#include <sri/shmpublisher.hpp>
+#include <sri/samplequeue.hpp>
+#include <sri/batcher.hpp>
+#include <sri/rtcolumns.hpp>
+#include <sri/filter.hpp>
+#include <sri/statistics.hpp>
+#include <sri/tare.hpp>
+#include <sri/trigger.hpp>
+#include <sri/wrenchtransform.hpp>
+#include <sri/spectrum.hpp>
+#include <sri/timing.hpp>
+#include <sri/autotune.hpp>
+#include <sri/trace.hpp>
+#include <sri/gaps.hpp>
 
 #include <memory>
-#include <regex>
+#include <mutex>
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include <numeric> // std::accumulate
 #include <thread>
-#include <boost/algorithm/string.hpp>
-#include <boost/lexical_cast.hpp>
-#include <boost/format.hpp>
-#include <boost/crc.hpp> //crc32
+#include <chrono>
+#include <future>
+#include <type_traits>
 #include <boost/function.hpp>
-#include <boost/thread.hpp>
-#include <boost/bind.hpp>
 
-//#define BOOST_THREAD_VERSION 5 //using the v5 version of boost::thread
 #define DELAY_US 500 //tcp delay in us
 #define WAIT_TIME 20 // Max_waiting_time = WAIT_TIME * DELAY_US
+#define RT_RING_CAPACITY 1024 // number of samples kept for subscribers
+#define ASYNC_TIMEOUT_MS 1000 // timeout of asynchronous commands in ms
 
 
 namespace SRI {
     class FTSensor {
     public:
-        explicit FTSensor(SensorComm *pcomm) : commPtr(pcomm) {
+        typedef BroadcastRing<RTSample> SampleRing;
+        typedef SampleRing::SubscriberPtr SampleSubscriber;
+
+        explicit FTSensor(SensorComm *pcomm) : commPtr(pcomm), sampleRing(RT_RING_CAPACITY),
+                                               queueCounters(std::make_shared<QueueCounters>()) {
             if (!commPtr->initialize()) {
-                std::cout << "Sensor initializing failed" << std::endl;
+                SRI_LOG(Error, "Sensor initializing failed");
             }
         }
 
-        IpAddr getIpAddress() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return IpAddr();
-            }
-
-            commPtr->write(generateCommandBuffer(EIP, "?"));
-
-            int waitTime = 0;
-            while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-                waitTime++;
-            }
-
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, EIP, "?");
-
-            return response;
+        /* SYNCHRONOUS COMMANDS
+         * Send a command and wait for its response. A failed getter yields an empty value, a failed setter false.
+         * The getters of parsed values have an overload returning false and why the response was rejected.
+         */
+        SRI_FTSENSOR_SDK_DECL IpAddr getIpAddress();
+        SRI_FTSENSOR_SDK_DECL bool setIpAddress(const IpAddr &ip);
+        SRI_FTSENSOR_SDK_DECL MacAddr getMacAddress();
+        SRI_FTSENSOR_SDK_DECL bool setMacAddress(const MacAddr &mac);
+        SRI_FTSENSOR_SDK_DECL GateAddr getGateWay();
+        SRI_FTSENSOR_SDK_DECL bool setGateWay(const GateAddr &gate);
+        SRI_FTSENSOR_SDK_DECL NetMask getNetMask();
+        SRI_FTSENSOR_SDK_DECL bool setNetMask(const NetMask &mask);
+        SRI_FTSENSOR_SDK_DECL Gains getChannelGains();
+        SRI_FTSENSOR_SDK_DECL bool getChannelGains(Gains &gains, ParseError &error);
+        SRI_FTSENSOR_SDK_DECL SampleRate getSamplingRate();
+        SRI_FTSENSOR_SDK_DECL bool getSamplingRate(SampleRate &rate, ParseError &error);
+        SRI_FTSENSOR_SDK_DECL bool setSamplingRate(SampleRate rate);
+        SRI_FTSENSOR_SDK_DECL Voltages getExcitationVoltages();
+        SRI_FTSENSOR_SDK_DECL bool getExcitationVoltages(Voltages &voltages, ParseError &error);
+        SRI_FTSENSOR_SDK_DECL Sensitivities getSensorSensitivities();
+        SRI_FTSENSOR_SDK_DECL bool getSensorSensitivities(Sensitivities &sens, ParseError &error);
+        SRI_FTSENSOR_SDK_DECL bool setSensorSensitivities(const Sensitivities &sens);
+        SRI_FTSENSOR_SDK_DECL Offsets getAmplifierZeroOffsets();
+        SRI_FTSENSOR_SDK_DECL bool getAmplifierZeroOffsets(Offsets &offsets, ParseError &error);
+        SRI_FTSENSOR_SDK_DECL bool setAmplifierZeroOffsets(const Offsets &offsets);
+        SRI_FTSENSOR_SDK_DECL RTDataMode getRealTimeDataMode();
+        SRI_FTSENSOR_SDK_DECL bool getRealTimeDataMode(RTDataMode &rtDataMode, ParseError &error);
+        SRI_FTSENSOR_SDK_DECL bool setRealTimeDataMode(const RTDataMode &rtDataMode);
+        SRI_FTSENSOR_SDK_DECL RTDataValid getRealTimeDataValid();
+        SRI_FTSENSOR_SDK_DECL bool setRealTimeDataValid(const RTDataValid &rtDataValid);
+
+        /* ASYNCHRONOUS QUERIES
+         * Non-blocking variants of the getters, carried out by the transport (see SensorComm::asyncTransact),
+         * so queries to many sensors can be in flight at the same time. A failed query is logged and yields
+         * the same empty value as the blocking getter. The handler variants report success as well and are
+         * called from the transport's thread.
+         */
+        std::future<IpAddr> asyncGetIpAddress() {
+            return asyncQuery<IpAddr>(EIP, "asyncGetIpAddress", parseText);
         }
 
-        bool setIpAddress(const IpAddr &ip) {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return false;
-            }
-
-            commPtr->write(generateCommandBuffer(EIP, ip));
-
-            int waitTime = 0;
-            while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-                waitTime++;
-            }
-
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, EIP, ip);
-
-            if (response == "OK")
-                return true;
-            else
-                return false;
+        void asyncGetIpAddress(boost::function<void(bool, const IpAddr&)> handler) {
+            asyncQuery<IpAddr>(EIP, "asyncGetIpAddress", parseText, handler);
         }
 
-        MacAddr getMacAddress() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return MacAddr();
-            }
-
-            commPtr->write(generateCommandBuffer(EMAC, "?"));
-
-            int waitTime = 0;
-            while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-                waitTime++;
-            }
+        std::future<MacAddr> asyncGetMacAddress() {
+            return asyncQuery<MacAddr>(EMAC, "asyncGetMacAddress", parseText);
+        }
 
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, EMAC, "?");
+        void asyncGetMacAddress(boost::function<void(bool, const MacAddr&)> handler) {
+            asyncQuery<MacAddr>(EMAC, "asyncGetMacAddress", parseText, handler);
+        }
 
-            return response;
+        std::future<GateAddr> asyncGetGateWay() {
+            return asyncQuery<GateAddr>(EGW, "asyncGetGateWay", parseText);
         }
 
-        bool setMacAddress(const MacAddr &mac) {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return false;
-            }
+        void asyncGetGateWay(boost::function<void(bool, const GateAddr&)> handler) {
+            asyncQuery<GateAddr>(EGW, "asyncGetGateWay", parseText, handler);
+        }
 
-            commPtr->write(generateCommandBuffer(EMAC, mac));
+        std::future<NetMask> asyncGetNetMask() {
+            return asyncQuery<NetMask>(ENM, "asyncGetNetMask", parseText);
+        }
 
-            int waitTime = 0;
-            while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-                waitTime++;
-            }
+        void asyncGetNetMask(boost::function<void(bool, const NetMask&)> handler) {
+            asyncQuery<NetMask>(ENM, "asyncGetNetMask", parseText, handler);
+        }
 
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, EIP, mac);
+        std::future<Gains> asyncGetChannelGains() {
+            return asyncQuery<Gains>(CHNAPG, "asyncGetChannelGains", static_cast<ParseError (*)(boost::string_view, Gains &)>(parseFloatList));
+        }
 
-            if (response == "OK")
-                return true;
-            else
-                return false;
+        void asyncGetChannelGains(boost::function<void(bool, const Gains&)> handler) {
+            asyncQuery<Gains>(CHNAPG, "asyncGetChannelGains", static_cast<ParseError (*)(boost::string_view, Gains &)>(parseFloatList), handler);
         }
 
-        GateAddr getGateWay() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return GateAddr();
-            }
+        std::future<SampleRate> asyncGetSamplingRate() {
+            return asyncQuery<SampleRate>(SMPR, "asyncGetSamplingRate", parseSampleRate);
+        }
 
-            commPtr->write(generateCommandBuffer(EGW, "?"));
+        void asyncGetSamplingRate(boost::function<void(bool, const SampleRate&)> handler) {
+            asyncQuery<SampleRate>(SMPR, "asyncGetSamplingRate", parseSampleRate, handler);
+        }
 
-            int waitTime = 0;
-            while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-                waitTime++;
-            }
+        std::future<Voltages> asyncGetExcitationVoltages() {
+            return asyncQuery<Voltages>(EXMV, "asyncGetExcitationVoltages", static_cast<ParseError (*)(boost::string_view, Voltages &)>(parseFloatList));
+        }
 
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, EGW, "?");
+        void asyncGetExcitationVoltages(boost::function<void(bool, const Voltages&)> handler) {
+            asyncQuery<Voltages>(EXMV, "asyncGetExcitationVoltages", static_cast<ParseError (*)(boost::string_view, Voltages &)>(parseFloatList), handler);
+        }
 
-            return response;
+        std::future<Sensitivities> asyncGetSensorSensitivities() {
+            return asyncQuery<Sensitivities>(SENS, "asyncGetSensorSensitivities", static_cast<ParseError (*)(boost::string_view, Sensitivities &)>(parseFloatList));
         }
 
-        bool setGateWay(const GateAddr &gate) {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return false;
-            }
+        void asyncGetSensorSensitivities(boost::function<void(bool, const Sensitivities&)> handler) {
+            asyncQuery<Sensitivities>(SENS, "asyncGetSensorSensitivities", static_cast<ParseError (*)(boost::string_view, Sensitivities &)>(parseFloatList), handler);
+        }
 
-            commPtr->write(generateCommandBuffer(EMAC, gate));
+        std::future<Offsets> asyncGetAmplifierZeroOffsets() {
+            return asyncQuery<Offsets>(AMPZ, "asyncGetAmplifierZeroOffsets", static_cast<ParseError (*)(boost::string_view, Offsets &)>(parseFloatList));
+        }
 
-            while (commPtr->available() == 0) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, EMAC, gate);
+        void asyncGetAmplifierZeroOffsets(boost::function<void(bool, const Offsets&)> handler) {
+            asyncQuery<Offsets>(AMPZ, "asyncGetAmplifierZeroOffsets", static_cast<ParseError (*)(boost::string_view, Offsets &)>(parseFloatList), handler);
+        }
 
-            if (response == "OK")
-                return true;
-            else
-                return false;
+        std::future<RTDataMode> asyncGetRealTimeDataMode() {
+            return asyncQuery<RTDataMode>(SGDM, "asyncGetRealTimeDataMode", parseRealTimeDataMode);
         }
 
-        NetMask getNetMask() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return NetMask();
-            }
+        void asyncGetRealTimeDataMode(boost::function<void(bool, const RTDataMode&)> handler) {
+            asyncQuery<RTDataMode>(SGDM, "asyncGetRealTimeDataMode", parseRealTimeDataMode, handler);
+        }
 
-            commPtr->write(generateCommandBuffer(ENM, "?"));
-            while (commPtr->available() == 0) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, ENM, "?");
+        std::future<RTDataValid> asyncGetRealTimeDataValid() {
+            return asyncQuery<RTDataValid>(DCKMD, "asyncGetRealTimeDataValid", parseText);
+        }
 
-            return response;
+        void asyncGetRealTimeDataValid(boost::function<void(bool, const RTDataValid&)> handler) {
+            asyncQuery<RTDataValid>(DCKMD, "asyncGetRealTimeDataValid", parseText, handler);
         }
 
-        bool setNetMask(const NetMask &mask) {
+        template<typename T>
+        std::vector<RTData<T>>
+        getRealTimeDataOnce(const RTDataMode &rtMode = RTDataMode(), const RTDataValid &rtValid = "SUM") {
             if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return false;
+                SRI_LOG(Error, "ERROR::Communication is not valid");
+                return std::vector<RTData<T>>();
             }
 
-            commPtr->write(generateCommandBuffer(ENM, mask));
+            announceRealTimeDataMode(rtMode);
+            commPtr->write("AT+GOD\r\n");
 
-            while (commPtr->available() == 0) {
+            while (commPtr->available() == 0 && commPtr->isValid()) {
                 std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
             }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, ENM, mask);
+            FrameBuffer &recvbuf = readResponse();
+            uint64_t timestamp = getReceiveTimestamp();
 
-            if (response == "OK")
-                return true;
-            else
-                return false;
-        }
+            //parse the received buffer
+            RTValidation validation = toRTValidation(rtValid);
+            uint32_t paritybit = parityBytes(validation);
 
-        Gains getChannelGains() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return Gains();
+            if (recvbuf.size() < 6 || ((uint8_t) recvbuf[0] != 0xAA) || ((uint8_t) recvbuf[1] != 0x55)) { // FRAME HEADER FAULT
+                SRI_LOG(Error, "SRI::REAL-TIME-ERROR::Frame header is fault. ");
+                return std::vector<RTData<T>>();
             }
 
-            commPtr->write(generateCommandBuffer(CHNAPG, "?"));
-
-            while (commPtr->available() == 0) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+            uint32_t PackageLength = (uint8_t) recvbuf[2] * 256 + (uint8_t) recvbuf[3];
+            if (PackageLength != recvbuf.size() - 4) {
+                SRI_LOG(Error, "SRI::REAL-TIME-ERROR::Package Length is fault. ");
+                return std::vector<RTData<T>>();
             }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, CHNAPG, "?");
 
-            std::vector<std::string> resInString;
-            try {
-                boost::split(resInString, response, boost::is_any_of(";"), boost::algorithm::token_compress_on);
-            }
-            catch (boost::bad_lexical_cast &e) {
-                std::cout << "ERROR::FTSensor::getChannelGains():" << e.what() << std::endl;
+            uint32_t dataLen = PackageLength - paritybit - 2;
+            if (dataLen != rtMode.channelOrder.size() * sizeof(T) * rtMode.PNpCH) {
+                SRI_LOG(Error, "SRI::REAL-TIME-ERROR::Expected Data Length is fault. Maybe Data Mode need update ");
+                return std::vector<RTData<T>>();
             }
-            Gains gains;
 
-            for (auto &res : resInString) {
-                gains.push_back(std::stof(res));
+            if (!checkFrame(recvbuf.data(), PackageLength, dataLen, validation)) {
+                SRI_LOG(Error, "SRI::REAL-TIME-ERROR::%s is incorrect. ", parityName(validation));
+                return std::vector<RTData<T>>();
             }
 
-            return gains;
-        }
-
-        SampleRate getSamplingRate() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return SampleRate();
-            }
+            RTColumns columns(rtMode.channelOrder.size(), rtMode.PNpCH);
+            RTBias bias = rtTare.current();
+            transposePayload<T>(&(recvbuf[6]), rtMode.PNpCH, columns, timestamp, bias.Active ? bias.Values : nullptr);
+            publishRealTimeData(columns);
 
-            commPtr->write(generateCommandBuffer(SMPR, "?"));
+            // decoded from the payload rather than the float columns, exact for every format
+            std::vector<RTData<T>> rtData;
+            decodePayload<T>(&(recvbuf[6]), rtMode.PNpCH, rtMode.channelOrder.size(), rtData, timestamp,
+                             bias.Active ? bias.Values : nullptr);
+            return rtData;
+        };
 
-            while (commPtr->available() == 0) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, SMPR, "?");
+        /// // this function need a callback function
+        /// The samples pass the float columns of the processing chain, so formats wider than 24 bits
+        /// keep only float precision, see RTColumns::toRTData. getRealTimeDataOnce returns exact values.
+        /// \tparam T The template parameters that defines the real time data format
+        /// \param rtDataHandler The callback function defined as: void rtDataHandler(std::vector<RTData<T>>&)
+        /// \param rtMode
+        /// \param rtValid
+        template<typename T>
+        void startRealTimeDataRepeatedly(boost::function<void(std::vector<RTData<T>>&)> rtDataHandler,
+                                         const RTDataMode &rtMode = RTDataMode(),
+                                         const RTDataValid &rtValid = "SUM") {
+            if (!beginRealTimeData(rtMode))
+                return;
 
-            return std::stoi(response);
+            boost::function<void()> idle;
+            boost::function<void()> finish;
+            boost::function<void(std::vector<RTData<T>>&)> deliver =
+                    makeRealTimeDelivery<std::vector<RTData<T>>, RTBatcher<T>>(rtDataHandler, idle, finish);
+
+            auto rtData = std::make_shared<std::vector<RTData<T>>>(); // reused, refilled from the pool if queued
+            boost::function<void(RTColumns&)> frameHandler = [deliver, rtData](RTColumns &columns) {
+                columns.toRTData(*rtData);
+                deliver(*rtData);
+            };
+            RTValidation validation = toRTValidation(rtValid);
+            startThread([this, frameHandler, idle, finish, rtMode, validation]() {
+                realTimeDataWorker<T>(frameHandler, idle, finish, rtMode, validation);
+            });
+
+            SRI_LOG(Info, "Getting real time data repeatedly.");
         }
 
-        bool setSamplingRate(SampleRate rate) {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return false;
-            }
+        /// Like startRealTimeDataRepeatedly, but the callback receives channel-major blocks with one
+        /// 32-byte aligned float column per channel, transposed directly from the received frames.
+        /// Use setRealTimeDataBatch to set the block size, the queue of setRealTimeDataQueue applies as well.
+        /// \tparam T The real time data format sent by the sensor
+        /// \param columnsHandler The callback function defined as: void columnsHandler(RTColumns&)
+        /// \param rtMode
+        /// \param rtValid
+        template<typename T>
+        void startRealTimeDataColumns(boost::function<void(RTColumns&)> columnsHandler,
+                                      const RTDataMode &rtMode = RTDataMode(),
+                                      const RTDataValid &rtValid = "SUM") {
+            if (!beginRealTimeData(rtMode))
+                return;
 
-            commPtr->write(generateCommandBuffer(SMPR, boost::lexical_cast<std::string>(rate)));
+            boost::function<void()> idle;
+            boost::function<void()> finish;
+            boost::function<void(RTColumns&)> deliver =
+                    makeRealTimeDelivery<RTColumns, RTColumnBatcher>(columnsHandler, idle, finish);
 
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, SMPR, boost::lexical_cast<std::string>(rate));
+            RTValidation validation = toRTValidation(rtValid);
+            startThread([this, deliver, idle, finish, rtMode, validation]() {
+                realTimeDataWorker<T>(deliver, idle, finish, rtMode, validation);
+            });
 
-            if (response == "OK")
-                return true;
-            else
-                return false;
+            SRI_LOG(Info, "Getting real time data repeatedly.");
         }
 
-        Voltages getExcitationVoltages() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return Voltages();
-            }
-
-            commPtr->write(generateCommandBuffer(EXMV, "?"));
-
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, EXMV, "?");
-
-            std::vector<std::string> resInString;
-            try {
-                boost::split(resInString, response, boost::is_any_of(";"), boost::algorithm::token_compress_on);
-            }
-            catch (boost::bad_lexical_cast &e) {
-                std::cout << "ERROR::FTSensor::getExcitationVoltages():" << e.what() << std::endl;
-            }
-            Voltages voltages;
-
-            for (auto &res : resInString) {
-                voltages.push_back(std::stof(res));
+        /// startRealTimeDataRepeatedly for any callable, e.g. a lambda. Without a queue or batching the callable
+        /// is stored by its own type in the receiving thread, so it is called directly and can be inlined into
+        /// the frame loop. With a queue or batching it is wrapped into a boost::function like before.
+        /// \tparam T       The real time data format sent by the sensor
+        /// \tparam Handler Callable as void(std::vector<RTData<T>>&)
+        template<typename T, typename Handler, typename = typename std::enable_if<
+                !std::is_same<Handler, boost::function<void(std::vector<RTData<T>>&)>>::value>::type>
+        void startRealTimeDataRepeatedly(Handler rtDataHandler,
+                                         const RTDataMode &rtMode = RTDataMode(),
+                                         const RTDataValid &rtValid = "SUM") {
+            if (queueCapacity > 0 || batchSamples > 1 || batchDelayUs > 0) {
+                startRealTimeDataRepeatedly<T>(boost::function<void(std::vector<RTData<T>>&)>(rtDataHandler),
+                                               rtMode, rtValid);
+                return;
             }
-
-            return voltages;
+            std::shared_ptr<std::vector<RTData<T>>> rtData = std::make_shared<std::vector<RTData<T>>>();
+            startRealTimeDataDirect<T>([rtDataHandler, rtData](RTColumns &columns) mutable {
+                columns.toRTData(*rtData);
+                rtDataHandler(*rtData);
+            }, rtMode, rtValid);
         }
 
-        Sensitivities getSensorSensitivities() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return Sensitivities();
-            }
-
-            commPtr->write(generateCommandBuffer(SENS, "?"));
-
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        /// startRealTimeDataColumns for any callable, see the callable startRealTimeDataRepeatedly
+        /// \tparam T       The real time data format sent by the sensor
+        /// \tparam Handler Callable as void(RTColumns&)
+        template<typename T, typename Handler, typename = typename std::enable_if<
+                !std::is_same<Handler, boost::function<void(RTColumns&)>>::value>::type>
+        void startRealTimeDataColumns(Handler columnsHandler,
+                                      const RTDataMode &rtMode = RTDataMode(),
+                                      const RTDataValid &rtValid = "SUM") {
+            if (queueCapacity > 0 || batchSamples > 1 || batchDelayUs > 0) {
+                startRealTimeDataColumns<T>(boost::function<void(RTColumns&)>(columnsHandler), rtMode, rtValid);
+                return;
             }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, SENS, "?");
+            startRealTimeDataDirect<T>(columnsHandler, rtMode, rtValid);
+        }
 
-            std::vector<std::string> resInString;
-            try {
-                boost::split(resInString, response, boost::is_any_of(";"), boost::algorithm::token_compress_on);
-            }
-            catch (boost::bad_lexical_cast &e) {
-                std::cout << "ERROR::FTSensor::getSensorSensitivities():" << e.what() << std::endl;
-            }
-            Sensitivities sens;
+        /// Find lost frames in real time data by the frame counter of the sensor, or by the arrival times against
+        /// the sampling rate if there is no counter, and optionally fill them by interpolation before the
+        /// filters see the data. The tare and the triggers only see received samples, the transform is linear
+        /// and applied before the fill. Takes effect at the next start of real time data.
+        /// \param config     The detection settings
+        void setRealTimeDataGapDetection(const RTGapConfig &config) {
+            gapConfig = config;
+        }
 
-            for (auto &res : resInString) {
-                sens.push_back(std::stof(res));
-            }
+        /// Get the lost frames since the last start of real time data. Safe to call from any thread.
+        RTGaps getRealTimeDataGaps() const {
+            return rtGaps.get();
+        }
 
-            return sens;
+        /// Replace a lost connection and send the settings made with this object again: the sampling rate,
+        /// sensitivities, real time data mode and validation, in the order they were first set. Real time data
+        /// must be stopped, see setAutoReconnect to recover while streaming.
+        /// \return false if the connection or a setting failed
+        SRI_FTSENSOR_SDK_DECL bool reconnect();
+
+        /// Recover from a lost connection while real time data is received: the receiving thread reconnects
+        /// with reconnect() and restarts the stream instead of ending. The frames sent meanwhile are lost.
+        /// Takes effect at the next start of real time data.
+        /// \param enable     Reconnect automatically, off by default
+        /// \param retryMs    Pause between failed attempts, which go on until stopRealTimeDataRepeatedly
+        void setAutoReconnect(bool enable, uint32_t retryMs = 100) {
+            autoReconnect = enable;
+            reconnectRetryMs = retryMs;
         }
 
-        bool setSensorSensitivities(const Sensitivities &sens) {
-            std::string parameters;
-            for (auto &s : sens) {
-                parameters += boost::lexical_cast<std::string>(s) + ";";
-            }
-            parameters = parameters.substr(0, parameters.find_last_of(';'));
+        SRI_FTSENSOR_SDK_DECL void stopRealTimeDataRepeatedly();
+
+        /// Wait after stopRealTimeDataRepeatedly until the receiving thread, and the dispatching thread of a queue,
+        /// have finished. The handlers are not called anymore then and the sensor can be destroyed.
+        /// \param timeoutMs  Maximum time to wait
+        /// \return           false if they are still running
+        SRI_FTSENSOR_SDK_DECL bool waitRealTimeDataFinished(uint32_t timeoutMs = 1000);
+
+        /// Decouple the callback of startRealTimeDataRepeatedly from the receiving thread.
+        /// Decoded frames are passed through a bounded queue to a dispatching thread which calls the callback.
+        /// Takes effect at the next startRealTimeDataRepeatedly.
+        /// \param policy   What happens to frames when the callback falls behind and the queue is full
+        /// \param capacity Maximum number of queued frames, 0 calls the callback in the receiving thread (default)
+        void setRealTimeDataQueue(OverflowPolicy policy, size_t capacity) {
+            queuePolicy = policy;
+            queueCapacity = capacity;
+        }
 
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return false;
-            }
+        /// Deliver real time data to the callback of startRealTimeDataRepeatedly in batches.
+        /// The callback is called once per maxSamples samples, or earlier when the oldest sample is maxDelayUs old.
+        /// The delay is checked about every DELAY_US. Takes effect at the next startRealTimeDataRepeatedly.
+        /// \param maxSamples  Number of samples in a full batch, 1 delivers every frame as received (default)
+        /// \param maxDelayUs  Maximum age of a partial batch in us, 0 for no limit
+        void setRealTimeDataBatch(size_t maxSamples, uint32_t maxDelayUs = 0) {
+            batchSamples = maxSamples;
+            batchDelayUs = maxDelayUs;
+        }
 
-            commPtr->write(generateCommandBuffer(SENS, parameters));
+        /// Filter real time data on the host before it is published or passed to the callback,
+        /// e.g. a median spike filter, a Butterworth low-pass and a decimator to deliver a clean stream at a
+        /// fraction of SMPR. The filters run in the receiving thread and are reset at every start.
+        /// Takes effect at the next startRealTimeDataRepeatedly or startRealTimeDataColumns.
+        /// \param chain The filter stages, nullptr to disable filtering
+        void setRealTimeDataFilter(std::shared_ptr<RTFilterChain> chain) {
+            filterChain = chain;
+        }
 
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, SENS, parameters);
+        /// Keep per-channel statistics (mean, variance, min/max, RMS) of real time data, since start and
+        /// over a sliding window. They are updated in the receiving thread after the filters.
+        /// Takes effect at the next startRealTimeDataRepeatedly or startRealTimeDataColumns.
+        /// \param window Length of the sliding window in samples, 0 to disable statistics
+        void setRealTimeDataStatistics(size_t window) {
+            std::shared_ptr<RTStatisticsAccumulator> accumulator;
+            if (window > 0)
+                accumulator = std::make_shared<RTStatisticsAccumulator>(window);
+            std::atomic_store(&statistics, accumulator);
+        }
 
-            if (response == "OK")
-                return true;
-            else
-                return false;
+        /// Get the statistics of real time data without locking, safe from any thread.
+        /// \return The statistics, ChannelNumber is 0 if disabled or no sample has been received
+        RTStatistics getRealTimeDataStatistics() const {
+            std::shared_ptr<RTStatisticsAccumulator> accumulator = std::atomic_load(&statistics);
+            return accumulator ? accumulator->get() : RTStatistics();
         }
 
-        Offsets getAmplifierZeroOffsets() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return Offsets();
-            }
+        /// Restart the statistics with the next received samples, safe from any thread
+        void resetRealTimeDataStatistics() {
+            std::shared_ptr<RTStatisticsAccumulator> accumulator = std::atomic_load(&statistics);
+            if (accumulator)
+                accumulator->requestReset();
+        }
 
-            commPtr->write(generateCommandBuffer(AMPZ, "?"));
+        /// Zero the real time data on the host: average the next nSamples samples of the running stream and
+        /// subtract the result from all following samples. Streaming is not interrupted. The bias is
+        /// subtracted while decoding, before the filters. If a tare is already running, its future is returned.
+        /// \param nSamples Number of samples to average
+        /// \return         Becomes ready with the new bias of each channel once it is installed. Throws
+        ///                 std::runtime_error if no real time data is received or it stops before
+        std::shared_future<Offsets> tareRealTimeData(size_t nSamples = 100) {
+            std::shared_future<Offsets> bias = rtTare.start(nSamples);
+            if (!isRepeatedly)
+                rtTare.cancel("SRI::FTSensor::tareRealTimeData::Real time data is not running");
+            return bias;
+        }
 
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, AMPZ, "?");
-
-            std::vector<std::string> resInString;
-            try {
-                boost::split(resInString, response, boost::is_any_of(";"),
-                             boost::algorithm::token_compress_on);
-            }
-            catch (boost::bad_lexical_cast &e) {
-                std::cout << "ERROR::FTSensor::getAmplifierZeroOffsets():" << e.what() << std::endl;
-            }
-            Offsets offsets;
+        /// Set the host-side bias directly, e.g. to restore a previous tare
+        /// \param bias The bias of each channel in channelOrder, empty to remove it
+        void setRealTimeDataBias(const Offsets &bias) {
+            rtTare.set(bias);
+        }
 
-            for (auto &res : resInString) {
-                offsets.push_back(std::stof(res));
-            }
+        /// Get the host-side bias, empty if none is set
+        Offsets getRealTimeDataBias() const {
+            return rtTare.get();
+        }
 
-            return offsets;
+        /// Transform the wrench into a tool or base frame right after decoding and tare, so the triggers,
+        /// filters, publishers and callbacks all see the transformed wrench. Keep the pointer to change
+        /// the mounting transform while streaming. Takes effect at the next start of real time data.
+        /// \param transform The transform, nullptr to disable
+        void setRealTimeDataTransform(std::shared_ptr<WrenchTransform> transform) {
+            wrenchTransform = transform;
         }
 
-        bool setAmplifierZeroOffsets(const Offsets &offsets) {
-            std::cout << "SRI::FTSensor::setAmplifierZeroOffsets::Has not been implemented." << std::endl;
-            return false;
+        /// Evaluate trigger rules (thresholds, hysteresis, rate of change, debounce) on every sample right
+        /// after decoding and tare, before the filters, queue and callback. Events are raised in the
+        /// receiving thread. Takes effect at the next startRealTimeDataRepeatedly or startRealTimeDataColumns.
+        /// \param trigger The rules and event handler, nullptr to disable
+        void setRealTimeDataTrigger(std::shared_ptr<RTTrigger> trigger) {
+            rtTrigger = trigger;
         }
 
-        RTDataMode getRealTimeDataMode() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return RTDataMode();
-            }
+        /// Get the drop counters and watermark of the real time data queue, counted in frames.
+        /// Safe to call from any thread. The counters are reset at each startRealTimeDataRepeatedly.
+        QueueStatus getRealTimeDataQueueStatus() const {
+            QueueStatus status;
+            status.Policy = queuePolicy;
+            status.Capacity = queueCapacity;
+            status.Pushed = queueCounters->Pushed;
+            status.Delivered = queueCounters->Delivered;
+            status.Dropped = queueCounters->Dropped;
+            status.Replaced = queueCounters->Replaced;
+            status.Blocked = queueCounters->Blocked;
+            status.Depth = queueCounters->Depth;
+            status.HighWatermark = queueCounters->HighWatermark;
+            return status;
+        }
 
-            commPtr->write(generateCommandBuffer(SGDM, "?"));
+        /// Get the load and latency of the receiving thread since the last start of real time data.
+        /// Safe to call from any thread.
+        RTTiming getRealTimeDataTiming() const {
+            return rtTiming.get(getTimestamp());
+        }
 
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, SGDM, "?");
-
-            std::vector<std::string> resInString;
-            try {
-                boost::split(resInString, response, boost::is_any_of(";"),
-                             boost::algorithm::token_compress_on);
-            }
-            catch (boost::bad_lexical_cast &e) {
-                std::cout << "ERROR::FTSensor::getRealTimeDataMode():" << e.what() << std::endl;
-            }
+        /// Record the way of every frame through the receiving thread, and the callbacks of the dispatching
+        /// thread if a queue is used, as spans in the tracer: read, validate, decode, process and handler.
+        /// Export them with RTTracer::exportChromeTrace. Without a tracer only a null check per stage remains.
+        /// Takes effect at the next start of real time data.
+        /// \param tracer     The tracer, nullptr to stop tracing
+        void setRealTimeDataTrace(std::shared_ptr<RTTracer> tracer) {
+            std::atomic_store(&rtTracer, tracer);
+        }
 
-            if (resInString.size() != 4)
-                std::cout << "ERROR::FTSensor::getRealTimeDataMode():Parse Data False" << std::endl;
+        /// Pick PNpCH for this host: stream each candidate of the config for MeasureMs with the real callback,
+        /// measure the load and latency of the receiving thread and set the smallest PNpCH that meets the
+        /// CPU budget and the latency limit with setRealTimeDataMode. The other fields of the sensor's data
+        /// mode are kept. Real time data must be stopped. setRealTimeDataBatch, setRealTimeDataQueue and the
+        /// filters apply during the measurement as they will later.
+        /// \tparam T             The real time data format sent by the sensor
+        /// \param columnsHandler The callback used while measuring, as for startRealTimeDataColumns
+        /// \param config         The limits and candidates
+        /// \param rtValid        The data validation method
+        /// \return               The trials and the chosen PNpCH, the data mode is unchanged if Success is false
+        template<typename T>
+        AutoTuneResult tuneRealTimeDataMode(boost::function<void(RTColumns&)> columnsHandler,
+                                            const AutoTuneConfig &config = AutoTuneConfig(),
+                                            const RTDataValid &rtValid = "SUM") {
+            if (isRepeatedly || rtWorkers > 0) {
+                SRI_LOG(Error, "ERROR::FTSensor::tuneRealTimeDataMode():Stop real time data first");
+                return AutoTuneResult();
+            }
+            RTDataMode rtMode = getRealTimeDataMode();
+            SampleRate rate = getSamplingRate();
+            if (rate == 0 || rtMode.channelOrder.empty()) {
+                SRI_LOG(Error, "ERROR::FTSensor::tuneRealTimeDataMode():Cannot read the data mode or sampling rate");
+                return AutoTuneResult();
+            }
+            uint16_t original = rtMode.PNpCH;
+
+            RTAutoTuner tuner(config, rate);
+            uint16_t pnpch;
+            while (tuner.next(pnpch)) {
+                rtMode.PNpCH = pnpch;
+                if (!setRealTimeDataMode(rtMode))
+                    break;
+                startRealTimeDataColumns<T>(columnsHandler, rtMode, rtValid);
+                std::this_thread::sleep_for(std::chrono::milliseconds(config.MeasureMs));
+                RTTiming timing = getRealTimeDataTiming();
+                stopRealTimeDataRepeatedly();
+                if (!waitRealTimeDataStopped()) {
+                    // commands would race the receiving thread for the responses, leave the data mode as it is
+                    SRI_LOG(Error, "ERROR::FTSensor::tuneRealTimeDataMode():Real time data did not stop, aborted");
+                    AutoTuneResult aborted = tuner.result();
+                    aborted.Success = false;
+                    return aborted;
+                }
+                tuner.report(timing);
+                SRI_LOG(Info, "SRI::FTSensor::tuneRealTimeDataMode():PNpCH %u load %.3f latency %.0f us",
+                        unsigned(pnpch), timing.Load, tuner.result().Trials.back().Latency / 1e3);
+            }
+
+            const AutoTuneResult &result = tuner.result();
+            rtMode.PNpCH = result.Success ? result.PNpCH : original;
+            if (!setRealTimeDataMode(rtMode))
+                SRI_LOG(Error, "ERROR::FTSensor::tuneRealTimeDataMode():Cannot set PNpCH %u", unsigned(rtMode.PNpCH));
+            if (!result.Success)
+                SRI_LOG(Warning, "SRI::FTSensor::tuneRealTimeDataMode():No candidate meets the limits, PNpCH unchanged");
+            return result;
+        }
 
+        /// Get the newest decoded sample without waiting or locking.
+        /// Safe to call from any thread while real time data is received repeatedly.
+        /// \return The newest sample, its Sequence is 0 if no sample has been received yet
+        RTSample getLatestRealTimeData() const {
+            return latestSample.load();
+        }
 
-            RTDataMode rtDataMode;
-            //1. Get the relevant analog channels. format: (A01,A02,A03,A04,A05,A06)
-            std::vector<std::string> channelsInString;
-            boost::trim_if(resInString[0], boost::is_any_of("()"));
-            boost::split(channelsInString, resInString[0], boost::is_any_of("(),"),
-                         boost::algorithm::token_compress_on);
-            rtDataMode.channelOrder.clear(); //rtDataMode has default value 1,2,3,4,5,6
-            for (auto &cs : channelsInString) {
-                auto c = std::stoi(cs.substr(cs.find('A') + 1));
-                rtDataMode.channelOrder.push_back(c);
-            }
-            //2. The unit of data uploaded from M8128.
-            rtDataMode.DataUnit = resInString[1][0];
-            //3. Number of data which are desired.
-            rtDataMode.PNpCH = std::stoi(resInString[2]);
-            //4. Filter model. Set to WMA. format: (WMA:1,1,2,3,4)
-            std::vector<std::string> fmInString;
-            boost::trim_if(resInString[3], boost::is_any_of("()"));
-            boost::split(fmInString, resInString[3], boost::is_any_of("():"),
-                         boost::algorithm::token_compress_on);
-
-            rtDataMode.FM = fmInString[0];
-            //5. WMA's relevant parameters, default 1.
-            std::vector<std::string> weightsInString;
-            boost::split(weightsInString, fmInString[1], boost::is_any_of(","),
-                         boost::algorithm::token_compress_on);
-            rtDataMode.filterWeights.clear();
-            for (auto &ws : weightsInString) {
-                auto w = std::stoi(ws);
-                rtDataMode.filterWeights.push_back(w);
-            }
+        /// Try to get the newest decoded sample once.
+        /// \param[out] sample The newest sample
+        /// \return            false if the sample was being updated, the caller can retry or keep the old one
+        bool tryGetLatestRealTimeData(RTSample &sample) const {
+            return latestSample.tryLoad(sample);
+        }
 
-            return rtDataMode;
+        /// Subscribe to every decoded sample. Each subscriber has its own cursor, so a slow one
+        /// never delays the others. Call poll() on the subscriber from the consuming thread.
+        /// \param policy Overwrite skips samples when the subscriber is RT_RING_CAPACITY samples behind,
+        ///               Block makes the receiving thread wait for it instead
+        /// \return       The subscriber, pass it to unsubscribeRealTimeData() when done
+        SampleSubscriber subscribeRealTimeData(SampleRing::Policy policy = SampleRing::Policy::Overwrite) {
+            return sampleRing.subscribe(policy);
         }
 
-        bool setRealTimeDataMode(const RTDataMode &rtDataMode) {
-            //format (A02,A03,A04,A01,A05,A06);C;1;(WMA:1,1,2,3)
-            //1.
-            std::string parameters;
-            parameters += "(";
-            for (auto &c : rtDataMode.channelOrder) {
-                parameters += boost::str(boost::format("A%02d,") % c);
-            }
-            boost::trim_right_if(parameters, boost::is_any_of(","));
-            parameters += ");";
-            //2.
-            parameters += rtDataMode.DataUnit;
-            parameters += ";";
-            //3.
-            parameters += std::to_string(rtDataMode.PNpCH);
-            parameters += ";";
-            //4.
-            std::string weights;
-            for (auto &w : rtDataMode.filterWeights) {
-                weights += boost::str(boost::format("%d,") % w);
-            }
-            boost::trim_right_if(weights, boost::is_any_of(","));
-            parameters += boost::str(boost::format("(%s:%s)") % rtDataMode.FM % weights);
+        void unsubscribeRealTimeData(const SampleSubscriber &subscriber) {
+            sampleRing.unsubscribe(subscriber);
+        }
 
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
+#ifdef SRI_FTSENSOR_SDK_HAS_SHM
+        /// Publish every decoded sample into a POSIX shared memory ring, read it from other processes with ShmReader.
+        /// Call it before starting real time data.
+        /// \param name     The shared memory object name, e.g. "/sri_ftsensor"
+        /// \param capacity Number of samples kept in the ring
+        /// \param permissions Access of the object, see ShmPublisher::open
+        /// \param replace  Remove an existing object of that name first, otherwise it is an error
+        /// \return         true if the shared memory was created
+        bool enableSharedMemory(const std::string &name, size_t capacity = RT_RING_CAPACITY,
+                                mode_t permissions = 0600, bool replace = false) {
+            std::unique_ptr<ShmPublisher> publisher(new ShmPublisher());
+            if (!publisher->open(name, capacity, permissions, replace)) {
                 return false;
             }
 
-            commPtr->write(generateCommandBuffer(SGDM, parameters));
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, SGDM, parameters);
-
-            if (response == "OK")
-                return true;
-            else
-                return false;
+            shmPublisher = std::move(publisher);
+            return true;
         }
 
-        RTDataValid getRealTimeDataValid() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return RTDataValid();
-            }
-
-            commPtr->write(generateCommandBuffer(DCKMD, "?"));
+        /// Stop publishing into shared memory and remove it. Call it after stopping real time data.
+        void disableSharedMemory() {
+            shmPublisher.reset();
+        }
+#endif
 
-            while (commPtr->available() == 0) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, DCKMD, "?");
+    private:
+        std::shared_ptr<SensorComm> commPtr; //store the polymorphic pointer of communication
+        std::atomic<bool> isRepeatedly{false}; // if start RT Data Repeatedly, set true
+        SeqLock<RTSample> latestSample; // newest decoded sample, written by the receiving thread only
+        SampleRing sampleRing; // every decoded sample, read by subscribers
+#ifdef SRI_FTSENSOR_SDK_HAS_SHM
+        std::unique_ptr<ShmPublisher> shmPublisher; // optional publisher for other processes
+#endif
+        OverflowPolicy queuePolicy = OverflowPolicy::Block; // overflow policy of the real time data queue
+        size_t queueCapacity = 0; // capacity of the real time data queue, 0 if not used
+        std::shared_ptr<QueueCounters> queueCounters; // statistics of the real time data queue
+        RTTare rtTare; // host-side bias, subtracted while decoding
+        std::shared_ptr<WrenchTransform> wrenchTransform; // optional frame transformation
+        std::shared_ptr<RTTrigger> rtTrigger; // optional trigger rules
+        std::shared_ptr<RTFilterChain> filterChain; // optional host-side filters
+        std::shared_ptr<RTStatisticsAccumulator> statistics; // optional statistics, accessed with atomic_load/store
+        size_t batchSamples = 1; // number of samples per batch delivered to the callback
+        uint32_t batchDelayUs = 0; // maximum age of a partial batch in us, 0 for no limit
+        uint64_t sampleSequence = 0; // number of samples published so far
+        RTTimingCounters rtTiming; // load and latency of the receiving thread
+        std::shared_ptr<RTTracer> rtTracer; // optional frame lifecycle trace, see setRealTimeDataTrace
+        RTGapConfig gapConfig; // settings of the gap detection
+        RTGapDetector rtGaps; // lost frames of the receiving thread
+        std::atomic<SampleRate> samplingRate{0}; // last rate read or set, 0 if unknown, read by the receiving thread
+        std::atomic<int> rtWorkers{0}; // receiving and dispatching threads started and not yet finished
+        std::vector<std::pair<std::string, std::string>> sensorConfig; // accepted settings, replayed by reconnect
+        std::mutex configMutex; // guards sensorConfig
+        bool autoReconnect = false; // the receiving thread reconnects when the connection is lost
+        uint32_t reconnectRetryMs = 100; // pause between failed reconnects of the receiving thread
 
-            return response;
-        }
+        /// Generate Command Buffer
+        /// \param[in] Command      The CMD such as UARTCFG.
+        /// \param[in] parameter    The parameters of the command.
+        /// \return                 command buffer(string format).
+        SRI_FTSENSOR_SDK_DECL std::string generateCommandBuffer(const std::string &command,
+                                                                const std::string &parameter);
 
-        bool setRealTimeDataValid(const RTDataValid &rtDataValid) {
+        /// Extract Response Buffer
+        /// \param[in] recvbuf          The reference of received buffer.
+        /// \param[in] expect_command   The expected command.
+        /// \return                     The response from sensor(string format)
+        SRI_FTSENSOR_SDK_DECL std::string extractResponseBuffer(const FrameBuffer &buf,
+                                                                const std::string &command,
+                                                                const std::string &parameter);
+
+        /// Send a query without waiting for the response
+        /// \tparam R              The type of the value
+        /// \param[in] command     The command, e.g. SMPR
+        /// \param[in] caller      The name of the calling method for the log
+        /// \param[in] parse       Converts the payload of the response into the value
+        /// \param[in] handler     Called with the value, or false and an empty value on error
+        template<typename R>
+        void asyncQuery(const std::string &command, const char *caller,
+                        ParseError (*parse)(boost::string_view, R &),
+                        boost::function<void(bool, const R&)> handler) {
             if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return false;
+                SRI_LOG(Error, "ERROR::Communication is not valid");
+                handler(false, R());
+                return;
             }
 
-            commPtr->write(generateCommandBuffer(DCKMD, rtDataValid));
-
-            while (commPtr->available() == 0 && commPtr->isValid() == true) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
-            std::string response = extractResponseBuffer(recvbuf, DCKMD, rtDataValid);
+            commPtr->asyncTransact(generateCommandBuffer(command, "?"), ASYNC_TIMEOUT_MS,
+                                   [command, caller, parse, handler](bool ok, const FrameBuffer &response) {
+                R value;
+                boost::string_view payload;
+                ParseError error = ParseError::Truncated;
+                if (ok)
+                    error = parseQueryResponse(response.data(), response.size(), command, payload);
+                if (error == ParseError::None)
+                    error = parse(payload, value);
+                if (error != ParseError::None) {
+                    SRI_LOG(Error, "ERROR::FTSensor::%s():%s", caller, ok ? toString(error) : "no response");
+                    handler(false, R());
+                    return;
+                }
+                handler(true, value);
+            });
+        }
 
-            if (response == "OK")
-                return true;
-            else
-                return false;
+        /// Send a query, the value is delivered through the future
+        template<typename R>
+        std::future<R> asyncQuery(const std::string &command, const char *caller,
+                                  ParseError (*parse)(boost::string_view, R &)) {
+            auto promise = std::make_shared<std::promise<R>>();
+            std::future<R> value = promise->get_future();
+            asyncQuery<R>(command, caller, parse, [promise](bool, const R &v) { promise->set_value(v); });
+            return value;
         }
 
-        template<typename T>
-        std::vector<RTData<T>>
-        getRealTimeDataOnce(const RTDataMode &rtMode = RTDataMode(), const RTDataValid &rtValid = "SUM") {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return std::vector<RTData<T>>();
-            }
+        /// Keep an accepted setting for replayConfig, replacing an earlier value of the same command
+        SRI_FTSENSOR_SDK_DECL void rememberConfig(const std::string &command, const std::string &parameter);
 
-            commPtr->write("AT+GOD\r\n");
+        /// Send the remembered settings again, e.g. after the sensor restarted
+        SRI_FTSENSOR_SDK_DECL bool replayConfig();
 
-            while (commPtr->available() == 0) {
-                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
-            }
-            std::vector<int8_t> recvbuf;
-            commPtr->read(recvbuf);
+        /// Reconnect the receiving thread after the connection was lost and start the stream again.
+        /// Retries until it succeeds or real time data is stopped.
+        SRI_FTSENSOR_SDK_DECL bool resumeRealTimeData();
 
-            //parse the received buffer
-            uint32_t paritybit = 1;
-            if (rtValid == "SUM") {
-                paritybit = 1;
-            } else if (rtValid == "CRC32") {
-                paritybit = 4;
-            }
+        /// Send the query AT+<command>=? and parse the response, with ParseError::NoResponse if nothing came
+        /// \param[out] payload  The payload, valid until the next readResponse() on this thread
+        SRI_FTSENSOR_SDK_DECL ParseError queryResponse(const std::string &command, boost::string_view &payload);
 
-            if (((uint8_t) recvbuf[0] != 0xAA) || ((uint8_t) recvbuf[1] != 0x55)) { // FRAME HEADER FAULT
-                std::cout << "SRI::REAL-TIME-ERROR::Frame header is fault. " << std::endl;
-                return std::vector<RTData<T>>();
-            }
+        /// Read the response to a command into a buffer reused by the calling thread. Commands run on the
+        /// caller's thread and, for reconnect and stop, on the receiving thread, so one shared buffer would race.
+        /// \return The buffer, valid until the next readResponse() on the same thread
+        SRI_FTSENSOR_SDK_DECL FrameBuffer &readResponse();
 
-            uint32_t PackageLength = recvbuf[2] * 256 + recvbuf[3];
-            if (PackageLength != recvbuf.size() - 4) {
-                std::cout << "SRI::REAL-TIME-ERROR::Package Length is fault. " << std::endl;
-                return std::vector<RTData<T>>();
-            }
+        uint8_t getChecksum(const int8_t *pData, size_t len) {
+            uint8_t sum = 0;
+            sum = std::accumulate(pData, pData + len, 0);
+            return sum;
+        }
 
-            uint32_t dataLen = PackageLength - paritybit - 2;
-            if (dataLen != rtMode.channelOrder.size() * sizeof(T) * rtMode.PNpCH) {
-                std::cout << "SRI::REAL-TIME-ERROR::Expected Data Length is fault. Maybe Data Mode need update "
-                          << std::endl;
-                return std::vector<RTData<T>>();
-            }
+        SRI_FTSENSOR_SDK_DECL uint32_t getCRC32(const int8_t *pData, size_t len);
 
-            //TODO:
-            if (rtValid == "SUM") {
-                if ((uint8_t) recvbuf.back() != getChecksum(&(recvbuf[6]), dataLen)) {
-                    std::cout << "SRI::REAL-TIME-ERROR::Checksum is incorrect. " << std::endl;
-                    return std::vector<RTData<T>>();
-                }
-            } else if (rtValid == "CRC32") {
-                uint32_t crc32 = getCRC32(&(recvbuf[6]), dataLen);
-                int8_t *pCRC = &(recvbuf[recvbuf.size() - 4]);
-                for (int i = 0; i < 4; i++) {
-                    if (pCRC[i] != ((int8_t *) &crc32)[i]) {
-                        std::cout << "SRI::REAL-TIME-ERROR::CRC32 is incorrect. " << std::endl;
-                        return std::vector<RTData<T>>();
-                    }
-                }
-            }
+        /// Get the steady clock time in ns, used to timestamp received frames
+        static uint64_t getTimestamp() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
 
-            std::vector<RTData<T>> rtData(rtMode.PNpCH);
-            // i*nChannel*sizeof(T) + sizeof(T)*j
-            size_t nChannel = rtMode.channelOrder.size();
-            for (int i = 0; i < rtMode.PNpCH; i++) {
-                for (int j = 0; j < nChannel; j++) {
-                    T val = *((T *) (&(recvbuf[6]) + i * nChannel * sizeof(T) + sizeof(T) * j));
-                    rtData[i][j] = val;
-                }
-            }
+        /// Timestamp of the last read: the kernel receive time if the transport provides it, otherwise now
+        uint64_t getReceiveTimestamp() {
+            uint64_t timestamp = commPtr->getReceiveTimestamp();
+            return timestamp != 0 ? timestamp : getTimestamp();
+        }
 
-            return rtData;
-        };
+        /// Run a receiving or dispatching thread, detached
+        SRI_FTSENSOR_SDK_DECL void startThread(const boost::function<void()> &body);
 
-        /// // this function need a callback function
-        /// \tparam T The template parameters that defines the real time data format
-        /// \param rtDataHandler The callback function defined as: void rtDataHandler(std::vector<RTData<T>>&)
-        /// \param rtMode
-        /// \param rtValid
-        template<typename T>
-        void startRealTimeDataRepeatedly(boost::function<void(std::vector<RTData<T>>&)> rtDataHandler,
-                                         const RTDataMode &rtMode = RTDataMode(),
-                                         const RTDataValid &rtValid = "SUM") {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
+        /// Start the receiving thread calling the handler by its own type, without queue or batcher
+        template<typename T, typename Handler>
+        void startRealTimeDataDirect(Handler frameHandler, const RTDataMode &rtMode, const RTDataValid &rtValid) {
+            if (!beginRealTimeData(rtMode))
                 return;
-            }
-
-            commPtr->write("AT+GSD\r\n");
 
-            isRepeatedly = true;
-            boost::thread(&FTSensor::realTimeDataCyclingHandler<T>, this, rtDataHandler, rtMode, rtValid).detach();
+            RTValidation validation = toRTValidation(rtValid);
+            startThread([this, frameHandler, rtMode, validation]() {
+                realTimeDataWorker<T, Handler>(frameHandler, boost::function<void()>(), boost::function<void()>(),
+                                               rtMode, validation);
+            });
 
-            std::cout << "Getting real time data repeatedly." << std::endl;
+            SRI_LOG(Info, "Getting real time data repeatedly.");
         }
 
-        void stopRealTimeDataRepeatedly() {
-            if (!commPtr->isValid()) {
-                std::cout << "ERROR::Communication is not valid" << std::endl;
-                return;
+        /// Check the parity bytes of a complete frame
+        /// \param[in] frame          The frame starting with AA 55
+        /// \param[in] PackageLength  The package length from the frame header
+        /// \param[in] dataLen        The payload length
+        bool checkFrame(const int8_t *frame, uint32_t PackageLength, uint32_t dataLen, RTValidation validation) {
+            switch (validation) {
+                case RTValidation::Sum:
+                    return (uint8_t) frame[PackageLength + 3] == getChecksum(frame + 6, dataLen);
+                case RTValidation::Crc32: {
+                    uint32_t crc32 = getCRC32(frame + 6, dataLen);
+                    return std::memcmp(frame + PackageLength, &crc32, 4) == 0;
+                }
+                default:
+                    return true;
             }
-
-            commPtr->write("AT+GSD=STOP\r\n");
-
-            isRepeatedly = false;
-            std::cout << "Stop real time data repeatedly" << std::endl;
         }
 
-    private:
-        std::shared_ptr<SensorComm> commPtr; //store the polymorphic pointer of communication
-        bool isRepeatedly = false; // if start RT Data Repeatedly, set true
-
-        /// Generate Command Buffer
-        /// \param[in] Command      The CMD such as UARTCFG.
-        /// \param[in] parameter    The parameters of the command.
-        /// \return                 command buffer(string format).
-        std::string generateCommandBuffer(const std::string &command,
-                                          const std::string &parameter) {
-            return AT + command + "=" + parameter + "\r\n";
+        static const char *parityName(RTValidation validation) {
+            return validation == RTValidation::Crc32 ? "CRC32" : "Checksum";
         }
 
-        /// Extract Response Buffer
-        /// \param[in] recvbuf          The reference of received buffer.
-        /// \param[in] expect_command   The expected command.
-        /// \return                     The response from sensor(string format)
-        std::string extractResponseBuffer(std::vector<int8_t> &buf,
-                                          const std::string &command,
-                                          const std::string &parameter) {
-            std::string s((char *) buf.data(), buf.size());
-
-            if (s.find(ACK) != 0)
-                return "";
-            if (s.find(command) == s.npos)
-                return "";
-
-            size_t nStart, nEnd;
-            if (parameter == "?") {
-                nStart = s.find("=") + 1;
-                nEnd = s.find("$");
-            } else {
-                nStart = s.find("$") + 1;
-                nEnd = s.find("\r\n");
-            }
-
-
-            return s.substr(nStart, nEnd - nStart);
+        /// Send the command to start real time data repeatedly
+        SRI_FTSENSOR_SDK_DECL bool beginRealTimeData(const RTDataMode &rtMode);
+
+        /// Wait for the receiving thread to finish after stopRealTimeDataRepeatedly, then discard the frames
+        /// that were still on the way, so the next command or start sees only new data
+        /// \return false if the threads are still running after timeoutMs, nothing is discarded then
+        SRI_FTSENSOR_SDK_DECL bool waitRealTimeDataStopped(uint32_t timeoutMs = 1000);
+
+        /// Build the chain between the receiving thread and the callback: the optional batcher
+        /// followed by the optional queue and its dispatching thread.
+        /// \tparam Frame          The type passed to the callback
+        /// \tparam Batcher        The batcher for Frame
+        /// \param[in] handler     The callback
+        /// \param[out] idle       To be called periodically by the receiving thread
+        /// \param[out] finish     To be called once by the receiving thread when it stops
+        /// \return                To be called by the receiving thread with every decoded frame
+        template<typename Frame, typename Batcher>
+        boost::function<void(Frame&)> makeRealTimeDelivery(boost::function<void(Frame&)> handler,
+                                                           boost::function<void()> &idle,
+                                                           boost::function<void()> &finish) {
+            boost::function<void(Frame&)> deliver = handler;
+            if (queueCapacity > 0) {
+                // the callback runs in its own thread, decoupled from receiving by a bounded queue
+                auto queue = std::make_shared<SampleQueue<Frame>>(queuePolicy, queueCapacity, queueCounters);
+                // handled frames return to the receiving thread with their storage, see realTimeDataDispatchHandler
+                auto pool = std::make_shared<ObjectPool<Frame>>(queueCapacity + 2);
+                auto filled = std::make_shared<bool>(false);
+                size_t samples = batchSamples;
+                rtWorkers++;
+                startThread([this, handler, queue, pool]() { realTimeDataDispatchHandler<Frame>(handler, queue, pool); });
+                deliver = [queue, pool, filled, samples](Frame &frame) {
+                    if (!*filled) {
+                        // enough storage of this shape for a full queue, so a new high of the queue does not allocate
+                        pool->fill(batchStorage(frame, samples));
+                        *filled = true;
+                    }
+                    queue->push(frame); // frame comes back with the storage of a lost entry, if any
+                    if (frame.capacity() == 0)
+                        pool->acquire(frame);
+                };
+                finish = [queue]() { queue->close(); };
+            }
+            if (batchSamples > 1 || batchDelayUs > 0) {
+                // samples are accumulated in the receiving thread, so the queue carries whole batches
+                auto batcher = std::make_shared<Batcher>(deliver, batchSamples, batchDelayUs);
+                boost::function<void()> closeQueue = finish;
+                deliver = [batcher](Frame &frame) { batcher->add(frame, getTimestamp()); };
+                idle = [batcher]() { batcher->poll(getTimestamp()); };
+                finish = [batcher, closeQueue]() {
+                    batcher->flush();
+                    if (closeQueue)
+                        closeQueue();
+                };
+            }
+            return deliver;
         }
 
-        uint8_t getChecksum(int8_t *pData, size_t len) {
-            uint8_t sum = 0;
-            sum = std::accumulate(pData, pData + len, 0);
-            return sum;
+        /// Describe the data mode of the following samples to the shared memory readers
+        void announceRealTimeDataMode(const RTDataMode &rtMode) {
+#ifdef SRI_FTSENSOR_SDK_HAS_SHM
+            if (shmPublisher)
+                shmPublisher->setRealTimeDataMode(rtMode);
+#endif
         }
 
-        uint32_t getCRC32(int8_t *pData, size_t len) {
-            boost::crc_32_type crc32;
-            crc32.process_bytes(pData, len);
+        /// Publish the decoded samples of one frame to the subscribers and as the newest sample
+        /// \param[in] columns     The decoded samples
+        void publishRealTimeData(const RTColumns &columns) {
+            if (columns.empty())
+                return;
 
-            return crc32.checksum();
+            RTSample sample;
+            for (size_t i = 0; i < columns.size(); i++) {
+                columns.toRTSample(i, sample);
+                sample.Sequence = ++sampleSequence;
+
+                sampleRing.publish(sample);
+#ifdef SRI_FTSENSOR_SDK_HAS_SHM
+                if (shmPublisher)
+                    shmPublisher->publish(sample);
+#endif
+            }
+
+            latestSample.store(sample);
         }
 
-        template<typename T>
-        void realTimeDataCyclingHandler(boost::function<void(std::vector<RTData<T>>&)> rtDataHandler,
+        /// Receive and decode frames until stopped
+        /// \tparam Handler        Callable as void(RTColumns&), a boost::function or the callable of a direct start
+        /// \param frameHandler    Called with every decoded frame
+        /// \param rtMode          The real time data mode
+        /// \param validation      The data validation method
+        /// \param idleHandler     Optional, called about every DELAY_US while waiting and after every received buffer
+        template<typename T, typename Handler = boost::function<void(RTColumns&)>>
+        void realTimeDataCyclingHandler(Handler &frameHandler,
                                         const RTDataMode &rtMode,
-                                        const RTDataValid &rtValid) {
+                                        RTValidation validation,
+                                        const boost::function<void()> &idleHandler = boost::function<void()>()) {
+            const uint32_t paritybit = parityBytes(validation);
+            RTGapConfig gaps = gapConfig;
+            if (gaps.SamplingRate <= 0)
+                gaps.SamplingRate = samplingRate;
+            rtGaps.reset(gaps, rtMode.channelOrder.size(), rtMode.PNpCH);
+            // room for the interpolated samples in front of the frame
+            const size_t frameCapacity = rtMode.PNpCH * (gaps.Interpolate ? 1 + gaps.MaxFillFrames : 1);
+            RTColumns frameColumns(rtMode.channelOrder.size(), frameCapacity); // reused for every frame
+            FrameBuffer recvbuf(RT_RECV_BUFFER_SIZE); // reused for every read
+            std::shared_ptr<WrenchTransform> transform = wrenchTransform;
+            std::shared_ptr<RTTrigger> trigger = rtTrigger;
+            if (trigger)
+                trigger->reset();
+            std::shared_ptr<RTFilterChain> filter = filterChain;
+            if (filter)
+                filter->reset();
+            std::shared_ptr<RTStatisticsAccumulator> stats = std::atomic_load(&statistics);
+            if (stats)
+                stats->requestReset();
+            queueCounters->reset(); // by the thread that pushes, not when the queue is built
+            rtTiming.reset(getTimestamp());
+            TraceBufferLease traceLease(std::atomic_load(&rtTracer), "receiving");
+            TraceBuffer *trace = traceLease.get();
+            uint64_t frameNumber = 0;
+
+            bool reconnect = autoReconnect;
 
             while (isRepeatedly) {
                 if (!commPtr->isValid()) {
-                    std::cout << "ERROR::Communication is not valid" << std::endl;
-                    return;
+                    if (!reconnect || !resumeRealTimeData()) {
+                        SRI_LOG(Error, "ERROR::Communication is not valid");
+                        isRepeatedly = false; // ended by the error, a later start or tuning must not see it running
+                        return;
+                    }
+                    recvbuf.clear(); // the incomplete frame of the lost connection
+                    rtGaps.restart();
+                    continue;
                 }
 
-                while (commPtr->available() == 0) {
+                while (commPtr->available() == 0 && isRepeatedly && commPtr->isValid()) {
                     std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+                    if (idleHandler)
+                        idleHandler();
                 }
-
-                std::vector<int8_t> recvbuf;
-                commPtr->read(recvbuf);
-
-                //parse the received buffer
-                uint32_t paritybit = 1;
-                if (rtValid == "SUM") {
-                    paritybit = 1;
-                } else if (rtValid == "CRC32") {
-                    paritybit = 4;
+                if (!isRepeatedly)
+                    break;
+                if (!commPtr->isValid())
+                    continue;
+
+                uint64_t readStart = getTimestamp();
+                commPtr->read(recvbuf); // appended to the incomplete frame of the last read, if any
+                uint64_t timestamp = getReceiveTimestamp();
+                if (trace) {
+                    uint64_t readEnd = getTimestamp();
+                    if (timestamp < readStart) // kernel receive timestamp
+                        trace->add(TraceKind::Socket, timestamp, readStart, recvbuf.size());
+                    trace->add(TraceKind::Read, readStart, readEnd, recvbuf.size());
                 }
 
-                while(!recvbuf.empty()) {
+                //parse the received buffer
+                size_t offset = 0; // start of the next frame in recvbuf
+                while (recvbuf.size() - offset >= 4) {
+                    const int8_t *frame = recvbuf.data() + offset;
 
-                    if (((uint8_t) recvbuf[0] != 0xAA) || ((uint8_t) recvbuf[1] != 0x55)) { // FRAME HEADER FAULT
-                        std::cout << "SRI::REAL-TIME-ERROR::Frame header is fault. " << std::endl;
+                    if (((uint8_t) frame[0] != 0xAA) || ((uint8_t) frame[1] != 0x55)) { // FRAME HEADER FAULT
+                        SRI_LOG(Error, "SRI::REAL-TIME-ERROR::Frame header is fault. ");
+                        isRepeatedly = false;
                         return;
                     }
 
-                    uint32_t PackageLength = recvbuf[2] * 256 + recvbuf[3];
+                    uint32_t PackageLength = (uint8_t) frame[2] * 256 + (uint8_t) frame[3];
 
-                    if(PackageLength != recvbuf.size() - 4) {
-                        std::cout << "SRI::REAL-TIME-WARNING::Package Length not equal to received buf. Package Length is: "
-                                    << PackageLength + 4 << " .  buf size is: " << recvbuf.size() << std::endl;
-                    }
-
-                    if (PackageLength > recvbuf.size() - 4) {
-                        std::cout << "SRI::REAL-TIME-ERROR::Package Length is fault. " << std::endl;
+                    if (PackageLength < paritybit + 2) {
+                        SRI_LOG(Error, "SRI::REAL-TIME-ERROR::Package Length is fault. ");
+                        isRepeatedly = false;
                         return;
                     }
 
                     uint32_t dataLen = PackageLength - paritybit - 2;
                     if (dataLen != rtMode.channelOrder.size() * sizeof(T) * rtMode.PNpCH) {
-                        std::cout << "SRI::REAL-TIME-ERROR::Expected Data Length is fault. Maybe Data Mode need update "
-                                  << std::endl;
+                        SRI_LOG(Error, "SRI::REAL-TIME-ERROR::Expected Data Length is fault. Maybe Data Mode need update ");
+                        isRepeatedly = false;
                         return;
                     }
 
-                    if (rtValid == "SUM") {
-                        if ((uint8_t) recvbuf[PackageLength + 3] != getChecksum(&(recvbuf[6]), dataLen)) {
-                            std::cout << "SRI::REAL-TIME-ERROR::Checksum is incorrect. " << std::endl;
-                            return;
-                        }
-                    } else if (rtValid == "CRC32") {
-                        uint32_t crc32 = getCRC32(&(recvbuf[6]), dataLen);
-                        int8_t *pCRC = &(recvbuf[recvbuf.size() - 4]);
-                        for (int i = 0; i < 4; i++) {
-                            if (pCRC[i] != ((int8_t *) &crc32)[i]) {
-                                std::cout << "SRI::REAL-TIME-ERROR::CRC32 is incorrect. " << std::endl;
-                                return;
-                            }
-                        }
-                    }
+                    if (PackageLength + 4 > recvbuf.size() - offset)
+                        break; // incomplete frame, completed by the next read
+                    uint64_t found = trace ? getTimestamp() : 0;
 
-                    std::vector<RTData<T>> rtData(rtMode.PNpCH);
-                    // i*nChannel*sizeof(T) + sizeof(T)*j
-                    size_t nChannel = rtMode.channelOrder.size();
-                    for (int i = 0; i < rtMode.PNpCH; i++) {
-                        for (int j = 0; j < nChannel; j++) {
-                            T val = *((T *) (&(recvbuf[6]) + i * nChannel * sizeof(T) + sizeof(T) * j));
-                            rtData[i][j] = val;
+                    if (!checkFrame(frame, PackageLength, dataLen, validation)) {
+                        // the length was plausible, so the stream stays in sync without this frame
+                        SRI_LOG(Error, "SRI::REAL-TIME-ERROR::%s is incorrect, frame dropped. ", parityName(validation));
+                        rtTiming.addCorruptFrame();
+                        offset += PackageLength + 4;
+                        continue;
+                    }
+                    uint64_t validated = trace ? getTimestamp() : 0;
+
+                    if (frameColumns.capacity() == 0) // moved away by the queue and the pool was empty
+                        frameColumns.reset(rtMode.channelOrder.size(), frameCapacity);
+                    frameColumns.clear();
+                    RTBias bias = rtTare.current(); // subtracted while decoding, no extra pass
+                    transposePayload<T>(frame + 6, rtMode.PNpCH, frameColumns, timestamp,
+                                        bias.Active ? bias.Values : nullptr);
+                    rtTare.update(frameColumns);
+                    uint64_t decoded = trace ? getTimestamp() : 0;
+                    if (transform)
+                        transform->process(frameColumns);
+                    if (trigger)
+                        trigger->process(frameColumns);
+                    // after the tare and triggers, which must not act on interpolated samples
+                    uint16_t counter = (uint8_t) frame[4] * 256 + (uint8_t) frame[5];
+                    if (uint32_t missing = rtGaps.process(counter, timestamp, frameColumns))
+                        SRI_LOG(Warning, "SRI::REAL-TIME::%u frames lost before frame counter %u", missing, counter);
+                    if (filter)
+                        filter->process(frameColumns);
+
+                    if (!frameColumns.empty()) { // the decimator may have dropped the whole frame
+                        if (stats)
+                            stats->add(frameColumns);
+                        publishRealTimeData(frameColumns);
+
+                        size_t nSamples = frameColumns.size(); // the queue may move the frame away
+                        uint64_t handlerStart = trace ? getTimestamp() : 0;
+                        frameHandler(frameColumns); // Callback function
+                        uint64_t done = getTimestamp();
+                        rtTiming.addFrame(nSamples, done > timestamp ? done - timestamp : 0);
+                        if (trace) {
+                            trace->add(TraceKind::Validate, found, validated, frameNumber);
+                            trace->add(TraceKind::Decode, validated, decoded, frameNumber);
+                            trace->add(TraceKind::Process, decoded, handlerStart, frameNumber);
+                            trace->add(TraceKind::Handler, handlerStart, done, frameNumber);
+                            trace->add(TraceKind::Frame, found, done, frameNumber);
                         }
                     }
+                    frameNumber++;
 
-                    rtDataHandler(rtData); // Callback function
-
-                    if(PackageLength != recvbuf.size() - 4) {
-                        std::vector<int8_t>(recvbuf.begin() + PackageLength + 4, recvbuf.end()).swap(recvbuf);
-                    }
-                    else
-                        break;
+                    offset += PackageLength + 4;
                 }
+                recvbuf.consume(offset);
+                rtTiming.addBusy(getTimestamp() - readStart);
+
+                if (idleHandler)
+                    idleHandler();
             }
         }
 
 
+        /// Receive frames until stopped, then flush the batcher and close the queue if used
+        template<typename T, typename Handler = boost::function<void(RTColumns&)>>
+        void realTimeDataWorker(Handler frameHandler,
+                                boost::function<void()> idle,
+                                boost::function<void()> finish,
+                                const RTDataMode &rtMode,
+                                RTValidation validation) {
+            realTimeDataCyclingHandler<T, Handler>(frameHandler, rtMode, validation, idle);
+            rtTare.cancel("SRI::FTSensor::tareRealTimeData::Real time data stopped");
+
+            if (finish)
+                finish();
+            rtWorkers--;
+        }
+
+        /// Pop frames from the queue and call the callback until the queue is closed and drained
+        template<typename Frame>
+        void realTimeDataDispatchHandler(boost::function<void(Frame&)> handler,
+                                         std::shared_ptr<SampleQueue<Frame>> queue,
+                                         std::shared_ptr<ObjectPool<Frame>> pool) {
+            TraceBufferLease traceLease(std::atomic_load(&rtTracer), "dispatching");
+            TraceBuffer *trace = traceLease.get();
+            uint64_t count = 0;
+            Frame frame;
+            while (queue->pop(frame)) {
+                uint64_t start = trace ? getTimestamp() : 0;
+                handler(frame); // Callback function
+                if (trace)
+                    trace->add(TraceKind::Dispatch, start, getTimestamp(), count++);
+                pool->release(std::move(frame));
+            }
+            rtWorkers--;
+        }
+
     }; // class FTSensor
+
+/// Instantiations of the real time data templates for one data format, see src/ftsensor.cpp
+#define SRI_FTSENSOR_SDK_RT_TEMPLATES(EXTERN, T) \
+    EXTERN template class RTBatcher<T>; \
+    EXTERN template void transposePayload<T>(const int8_t *, size_t, RTColumns &, uint64_t, const float *); \
+    EXTERN template void decodePayload<T>(const int8_t *, size_t, size_t, std::vector<RTData<T>> &, uint64_t, \
+                                          const float *); \
+    EXTERN template std::vector<RTData<T>> FTSensor::getRealTimeDataOnce<T>(const RTDataMode &, const RTDataValid &); \
+    EXTERN template AutoTuneResult FTSensor::tuneRealTimeDataMode<T>(boost::function<void(RTColumns&)>, \
+                                                                     const AutoTuneConfig &, const RTDataValid &); \
+    EXTERN template void FTSensor::startRealTimeDataRepeatedly<T>(boost::function<void(std::vector<RTData<T>>&)>, \
+                                                                  const RTDataMode &, const RTDataValid &); \
+    EXTERN template void FTSensor::startRealTimeDataColumns<T>(boost::function<void(RTColumns&)>, \
+                                                               const RTDataMode &, const RTDataValid &); \
+    EXTERN template void FTSensor::realTimeDataCyclingHandler<T>(boost::function<void(RTColumns&)> &, \
+                                                                 const RTDataMode &, RTValidation, \
+                                                                 const boost::function<void()> &); \
+    EXTERN template void FTSensor::realTimeDataWorker<T>(boost::function<void(RTColumns&)>, boost::function<void()>, \
+                                                         boost::function<void()>, const RTDataMode &, RTValidation);
+
+#ifdef SRI_FTSENSOR_SDK_SEPARATE_COMPILATION
+    // float and uint16_t are compiled once in the library, other formats are instantiated as usual
+    SRI_FTSENSOR_SDK_RT_TEMPLATES(extern, float)
+    SRI_FTSENSOR_SDK_RT_TEMPLATES(extern, uint16_t)
+#endif
 } //namespace SRI
 
 
+#ifndef SRI_FTSENSOR_SDK_SEPARATE_COMPILATION
+#include <sri/impl/ftsensor.ipp>
+#endif
+
 #endif //SRI_FTSENSOR_SDK_SRI_SENSOR_H
@@ -0,0 +1,251 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_GAPS_HPP
+#define SRI_FTSENSOR_SDK_GAPS_HPP
+
+#include <sri/rtcolumns.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+namespace SRI {
+    /// Detection and filling of lost frames, see FTSensor::setRealTimeDataGapDetection
+    struct RTGapConfig {
+        bool Interpolate = false;       // fill gaps found with the frame counter by linear interpolation
+        uint32_t MaxFillFrames = 16;    // longer gaps are only reported
+        double SamplingRate = 0;        // SMPR in Hz to infer loss from the arrival times if the sensor sends no
+                                        // frame counter, 0 for the rate last read or set with this FTSensor
+        uint32_t WindowMs = 200;        // arrival times are compared over windows of this length
+        double Tolerance = 0.75;        // frames a whole window may arrive late before frames count as lost
+    };
+
+    enum class GapSource {
+        None,       // not known yet, or no counter and no sampling rate
+        Counter,    // the frame counter in bytes 4 and 5 of every frame, exact
+        Timing      // arrival times against the sampling rate, misses gaps shorter than the tolerance
+    };
+
+    /// Lost frames of the current real time data stream. Gaps across a reconnect are not counted.
+    struct RTGaps {
+        GapSource Source = GapSource::None;
+        uint64_t Frames = 0;            // frames checked
+        uint64_t Gaps = 0;              // places where frames were missing
+        uint64_t LostFrames = 0;
+        uint64_t LostSamples = 0;
+        uint64_t FilledSamples = 0;     // interpolated samples passed on in place of the lost ones
+        uint64_t Resyncs = 0;           // counter jumps that are no multiple of its step, loss unknown
+    };
+
+    /// Finds lost frames in the stream of one receiving thread. The counter in bytes 4 and 5 is used once it has
+    /// advanced by the same step three times in a row, e.g. by 1 per frame or by PNpCH per frame. Until then, or
+    /// if it never does, loss is inferred from the arrival times if the sampling rate is known: the frames of a
+    /// window are compared with the time they were due, and the best of them being late by whole frames means
+    /// that these frames are missing. The remaining offset is absorbed, so transport jitter, bursts after a stall
+    /// and the drift between the sensor's and the host's clocks are not taken for loss.
+    /// process() is called by the receiving thread only, get() from any thread.
+    class RTGapDetector {
+    public:
+        /// Start a stream, called by the receiving thread
+        /// \param config           The detection settings, SamplingRate already resolved
+        /// \param channels         Channels per sample
+        /// \param samplesPerFrame  PNpCH
+        void reset(const RTGapConfig &config, size_t channels, size_t samplesPerFrame) {
+            _config = config;
+            _samplesPerFrame = std::max<size_t>(samplesPerFrame, 1);
+            _period = config.SamplingRate > 0 ? _samplesPerFrame * 1e9 / config.SamplingRate : 0;
+            _last.assign(channels, 0.0f);
+            _step = 0;
+            _candidate = 0;
+            _confirmed = 0;
+            restart();
+            _source.store(int(_period > 0 ? GapSource::Timing : GapSource::None), std::memory_order_relaxed);
+            for (auto counter : {&_frames, &_gaps, &_lostFrames, &_lostSamples, &_filled, &_resyncs})
+                counter->store(0, std::memory_order_relaxed);
+        }
+
+        /// Continue after a reconnect, the gap to the frames before is not counted
+        void restart() {
+            _havePrevious = false;
+            _haveLast = false;
+            _anchored = false;
+        }
+
+        /// Check a decoded frame and fill the gap in front of it if configured
+        /// \param counter          Bytes 4 and 5 of the frame
+        /// \param arrival          Receive time of the frame in ns
+        /// \param[in,out] columns  The decoded frame, interpolated samples are inserted in front of it
+        /// \return                 Number of frames missing before this one
+        uint32_t process(uint16_t counter, uint64_t arrival, RTColumns &columns) {
+            add(_frames, 1);
+            uint32_t missing = checkCounter(counter);
+            if (GapSource(_source.load(std::memory_order_relaxed)) == GapSource::Timing)
+                missing = checkTiming(arrival);
+
+            if (missing > 0) {
+                add(_gaps, 1);
+                add(_lostFrames, missing);
+                add(_lostSamples, missing * _samplesPerFrame);
+                if (_config.Interpolate && missing <= _config.MaxFillFrames
+                    && GapSource(_source.load(std::memory_order_relaxed)) == GapSource::Counter)
+                    add(_filled, fill(columns, missing * _samplesPerFrame));
+            }
+
+            if (!columns.empty()) {
+                for (size_t c = 0; c < _last.size() && c < columns.channels(); c++) {
+                    _last[c] = columns(c, columns.size() - 1);
+                }
+                _lastTimestamp = columns.timestamps()[columns.size() - 1];
+                _haveLast = true;
+            }
+            return missing;
+        }
+
+        RTGaps get() const {
+            RTGaps gaps;
+            gaps.Source = GapSource(_source.load(std::memory_order_relaxed));
+            gaps.Frames = _frames.load(std::memory_order_relaxed);
+            gaps.Gaps = _gaps.load(std::memory_order_relaxed);
+            gaps.LostFrames = _lostFrames.load(std::memory_order_relaxed);
+            gaps.LostSamples = _lostSamples.load(std::memory_order_relaxed);
+            gaps.FilledSamples = _filled.load(std::memory_order_relaxed);
+            gaps.Resyncs = _resyncs.load(std::memory_order_relaxed);
+            return gaps;
+        }
+
+    private:
+        static void add(std::atomic<uint64_t> &counter, uint64_t n) {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        /// Learn the step of the counter, then compare every frame's counter with the expected one
+        uint32_t checkCounter(uint16_t counter) {
+            uint16_t previous = _previous;
+            bool havePrevious = _havePrevious;
+            _previous = counter;
+            _havePrevious = true;
+            if (!havePrevious)
+                return 0;
+
+            uint16_t diff = uint16_t(counter - previous);
+            if (_step == 0) {
+                if (diff != 0 && diff == _candidate) {
+                    if (++_confirmed >= 2) { // three frames with the same step
+                        _step = diff;
+                        _source.store(int(GapSource::Counter), std::memory_order_relaxed);
+                    }
+                } else {
+                    _candidate = diff;
+                    _confirmed = 0;
+                }
+                return 0;
+            }
+
+            if (diff == _step)
+                return 0;
+            if (diff != 0 && diff % _step == 0)
+                return diff / _step - 1;
+            add(_resyncs, 1); // e.g. the sensor restarted its counter
+            return 0;
+        }
+
+        /// Compare the arrival times of a window with the times the frames were due
+        uint32_t checkTiming(uint64_t arrival) {
+            if (!_anchored) {
+                _anchor = double(arrival);
+                _due = 0;
+                _windowStart = arrival;
+                _windowMin = std::numeric_limits<double>::max();
+                _anchored = true;
+            }
+            _windowMin = std::min(_windowMin, double(arrival) - (_anchor + _due * _period));
+            _due++;
+
+            uint32_t missing = 0;
+            if (arrival >= _windowStart + uint64_t(_config.WindowMs) * 1000000ull) {
+                if (_windowMin > _config.Tolerance * _period)
+                    missing = uint32_t(std::llround(_windowMin / _period));
+                _due += missing;
+                _anchor += _windowMin - missing * _period; // the best frame of the window is due now
+                _windowStart = arrival;
+                _windowMin = std::numeric_limits<double>::max();
+            }
+            return missing;
+        }
+
+        /// Insert samples interpolated between the last sample of the previous frame and the first of this one
+        size_t fill(RTColumns &columns, size_t n) {
+            size_t decoded = columns.size();
+            if (!_haveLast || decoded == 0 || decoded + n > columns.capacity())
+                return 0;
+            columns.resize(decoded + n);
+            for (size_t c = 0; c < columns.channels(); c++) {
+                float *column = columns.channel(c);
+                std::memmove(column + n, column, decoded * sizeof(float));
+                float from = c < _last.size() ? _last[c] : column[n];
+                float to = column[n];
+                for (size_t i = 0; i < n; i++) {
+                    column[i] = from + (to - from) * float(i + 1) / float(n + 1);
+                }
+            }
+            uint64_t *timestamps = columns.timestamps();
+            std::memmove(timestamps + n, timestamps, decoded * sizeof(uint64_t));
+            uint64_t to = std::max(timestamps[n], _lastTimestamp);
+            for (size_t i = 0; i < n; i++) {
+                timestamps[i] = _lastTimestamp + (to - _lastTimestamp) * (i + 1) / (n + 1);
+            }
+            return n;
+        }
+
+        RTGapConfig _config;
+        size_t _samplesPerFrame = 1;
+        double _period = 0;                 // ns between two frames, 0 without sampling rate
+        // counter, receiving thread only
+        uint16_t _previous = 0;             // counter of the previous frame
+        bool _havePrevious = false;
+        uint16_t _step = 0;                 // counter increment per frame, 0 until learned
+        uint16_t _candidate = 0;            // step seen in the last frames
+        int _confirmed = 0;                 // further frames with the candidate step
+        // timing, receiving thread only
+        bool _anchored = false;
+        double _anchor = 0;                 // ns when the first frame of the stream was due
+        uint64_t _due = 0;                  // frames due since the anchor, lost ones included
+        uint64_t _windowStart = 0;
+        double _windowMin = 0;              // least lateness in ns within the window
+        // last sample, the start of an interpolation
+        std::vector<float> _last;
+        uint64_t _lastTimestamp = 0;
+        bool _haveLast = false;
+        // results, readable from any thread
+        std::atomic<int> _source{int(GapSource::None)};
+        std::atomic<uint64_t> _frames{0};
+        std::atomic<uint64_t> _gaps{0};
+        std::atomic<uint64_t> _lostFrames{0};
+        std::atomic<uint64_t> _lostSamples{0};
+        std::atomic<uint64_t> _filled{0};
+        std::atomic<uint64_t> _resyncs{0};
+    }; // class RTGapDetector
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_GAPS_HPP
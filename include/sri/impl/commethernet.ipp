@@ -0,0 +1,389 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_IMPL_COMMETHERNET_IPP
+#define SRI_FTSENSOR_SDK_IMPL_COMMETHERNET_IPP
+
+#include <sri/commethernet.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+
+#ifdef __linux__
+#include <linux/errqueue.h>  // scm_timestamping
+#include <linux/net_tstamp.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+namespace SRI {
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::initialize() {
+        return onEventLoop([this]() { return openConnection(); });
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::reconnect() {
+        return onEventLoop([this]() {
+            _validStatus = false;
+            boost::system::error_code error;
+            _socket.close(error); // a running transaction completes with operation_aborted
+            if (takeStandby()) {
+                SRI_LOG(Info, "SRI::ETHERNET::Switched to the standby connection");
+                _validStatus = true;
+                return true;
+            }
+            return openConnection();
+        });
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::openConnection() {
+        boost::system::error_code error;
+        if (_socket.is_open())
+            _socket.close(error);
+
+        socket_type::native_handle_type handle;
+        bool rxTimestamps = false;
+        if (connectSocket(handle, rxTimestamps, error))
+            _socket.assign(_endpoint.protocol(), handle, error);
+        if (error)
+            SRI_LOG(Error, "SRI::ETHERNET::Error connecting to sensors: %s", error.message().c_str());
+        _validStatus = !error;
+        _rxTimestamps = rxTimestamps;
+
+        if (_options.HotStandby)
+            startStandby();
+        return _validStatus;
+    }
+
+    SRI_FTSENSOR_SDK_DECL size_t CommEthernet::available() {
+        boost::system::error_code error;
+        size_t n = _socket.available(error);
+        if (n > 0)
+            _emptyPolls = 0;
+        else if (!error && _validStatus && ++_emptyPolls % PEER_CHECK_POLLS == 0 &&
+                 peerClosed(_socket.native_handle()))
+            error = boost::asio::error::eof;
+        if (error) {
+            connectionLost(error);
+            return 0;
+        }
+        return n;
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::asyncTransact(const std::string &command, uint32_t timeoutMs,
+                                                           ResponseHandler handler) {
+        if (!_validStatus) {
+            handler(false, FrameBuffer());
+            return;
+        }
+        startEventLoop();
+
+        auto transaction = std::make_shared<Transaction>();
+        transaction->Command = command;
+        if (command.compare(0, AT.size(), AT) == 0) {
+            size_t end = command.find_first_of("=\r", AT.size());
+            transaction->Echo = ACK + command.substr(AT.size(), end == std::string::npos ? end : end - AT.size());
+        }
+        transaction->Timeout = timeoutMs;
+        transaction->Handler = handler;
+        _io.post([this, transaction]() {
+            _transactions.push_back(transaction);
+            if (_transactions.size() == 1)
+                startTransaction();
+        });
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::connectSocket(socket_type::native_handle_type &handle, bool &rxTimestamps,
+                                                           boost::system::error_code &error) {
+        io_service io;
+        socket_type socket(io);
+        socket.open(_endpoint.protocol(), error);
+        if (error)
+            return false;
+        rxTimestamps = applySocketOptions(socket); // SO_RCVBUF has to be set before connecting for the window
+
+        bool done = false;
+        socket.async_connect(_endpoint, [&done, &error](const boost::system::error_code &result) {
+            done = true;
+            error = result;
+        });
+        if (_options.ConnectTimeoutMs > 0)
+            io.run_for(std::chrono::milliseconds(_options.ConnectTimeoutMs));
+        else
+            io.run();
+        if (!done)
+            error = boost::asio::error::timed_out; // the socket is closed on return, cancelling the connect
+        if (error)
+            return false;
+        handle = socket.release(error);
+        return !error;
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::startStandby() {
+        std::lock_guard<std::mutex> lock(_standbyMutex);
+        if (_standbyThread.joinable())
+            return;
+        _standbyThread = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(_standbyMutex);
+            while (!_stopping) {
+                if (_standby.is_open()) {
+                    _standbyWake.wait(lock);
+                    continue;
+                }
+                lock.unlock();
+                socket_type::native_handle_type handle;
+                bool rxTimestamps = false;
+                boost::system::error_code error;
+                bool connected = connectSocket(handle, rxTimestamps, error);
+                lock.lock();
+                if (connected) {
+                    _standby.assign(_endpoint.protocol(), handle, error);
+                    _standbyRxTimestamps = rxTimestamps;
+                } else if (_validStatus && error == boost::asio::error::connection_refused) {
+                    // refused while the active connection is up: the sensor serves a single connection
+                    SRI_LOG(Warning, "SRI::ETHERNET::The sensor refuses a second connection, hot standby disabled");
+                    break;
+                } else {
+                    // the sensor may be restarting, try again after a while
+                    _standbyWake.wait_for(lock, std::chrono::milliseconds(
+                            _options.ConnectTimeoutMs > 0 ? _options.ConnectTimeoutMs : 1000));
+                }
+            }
+            boost::system::error_code error;
+            _standby.close(error);
+        });
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::takeStandby() {
+        std::lock_guard<std::mutex> lock(_standbyMutex);
+        if (!_standby.is_open())
+            return false;
+        boost::system::error_code error;
+        socket_type::native_handle_type handle = 0;
+        if (peerClosed(_standby.native_handle()))
+            _standby.close(error); // lost as well, e.g. the sensor restarted
+        else
+            handle = _standby.release(error);
+        _standbyWake.notify_one(); // connect the next one
+        if (error || _standby.is_open() || handle == 0)
+            return false;
+        _socket.assign(_endpoint.protocol(), handle, error);
+        _rxTimestamps = _standbyRxTimestamps;
+        return !error;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::peerClosed(socket_type::native_handle_type handle) {
+#ifdef __linux__
+        char c;
+        ssize_t n = ::recv(handle, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+#else
+        (void) handle;
+        return false; // detected by the next failing read or write
+#endif
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::connectionLost(const boost::system::error_code &error) {
+        if (_validStatus)
+            SRI_LOG(Warning, "SRI::ETHERNET::Connection lost: %s", error.message().c_str());
+        _validStatus = false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL size_t CommEthernet::send(const const_buffer &data) {
+        if (!_validStatus) {
+            return 0;
+        }
+        boost::system::error_code error;
+        size_t n = _socket.write_some(data, error);
+        if (error)
+            connectionLost(error);
+        return n;
+    }
+
+    SRI_FTSENSOR_SDK_DECL size_t CommEthernet::receive(const mutable_buffer &data) {
+        boost::system::error_code error;
+        size_t n = _socket.read_some(data, error);
+        if (error)
+            connectionLost(error);
+        return n;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::applySocketOptions(socket_type &socket) {
+        boost::system::error_code error;
+        socket.set_option(ip::tcp::no_delay(_options.NoDelay), error);
+        if (error)
+            SRI_LOG(Warning, "SRI::ETHERNET::Error setting TCP_NODELAY: %s", error.message().c_str());
+        if (_options.ReceiveBuffer > 0) {
+            socket.set_option(socket_base::receive_buffer_size(_options.ReceiveBuffer), error);
+            if (error)
+                SRI_LOG(Warning, "SRI::ETHERNET::Error setting SO_RCVBUF: %s", error.message().c_str());
+        }
+        bool rxTimestamps = false;
+#ifdef __linux__
+        if (_options.BusyPoll > 0)
+            setOption(socket.native_handle(), SOL_SOCKET, SO_BUSY_POLL, _options.BusyPoll, "SO_BUSY_POLL");
+        if (_options.QuickAck)
+            setOption(socket.native_handle(), IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+        if (_options.RxTimestamps)
+            rxTimestamps = setOption(socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPING,
+                                     SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE, "SO_TIMESTAMPING");
+#else
+        if (_options.BusyPoll > 0 || _options.QuickAck || _options.RxTimestamps)
+            SRI_LOG(Warning, "SRI::ETHERNET::SO_BUSY_POLL, TCP_QUICKACK and SO_TIMESTAMPING need Linux, skipped");
+#endif
+        return rxTimestamps;
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::rearmQuickAck() {
+#ifdef __linux__
+        if (_options.QuickAck)
+            setOption(_socket.native_handle(), IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+#endif
+    }
+
+#ifdef __linux__
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::setOption(int handle, int level, int name, int value,
+                                                       const char *optionName) {
+        if (::setsockopt(handle, level, name, &value, sizeof(value)) == 0)
+            return true;
+        SRI_LOG(Warning, "SRI::ETHERNET::Error setting %s: %s", optionName, std::strerror(errno));
+        return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL size_t CommEthernet::receiveWithTimestamp(char *buf, size_t n) {
+        iovec iov;
+        iov.iov_base = buf;
+        iov.iov_len = n;
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+        msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t received = ::recvmsg(_socket.native_handle(), &msg, 0);
+        if (received < 0) {
+            connectionLost(boost::system::error_code(errno, boost::system::system_category()));
+            return 0;
+        }
+        _rxTimestamp = 0;
+        for (cmsghdr *c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping ts;
+                std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                _rxTimestamp = toSteadyClock(ts.ts[0]);
+            }
+        }
+        rearmQuickAck();
+        return size_t(received);
+    }
+
+    SRI_FTSENSOR_SDK_DECL uint64_t CommEthernet::toSteadyClock(const timespec &kernelTime) {
+        timespec realtime;
+        ::clock_gettime(CLOCK_REALTIME, &realtime);
+        uint64_t steady = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t age = (int64_t(realtime.tv_sec) - kernelTime.tv_sec) * 1000000000ll
+                      + (realtime.tv_nsec - kernelTime.tv_nsec);
+        return age > 0 && uint64_t(age) < steady ? steady - uint64_t(age) : steady;
+    }
+#endif
+
+    SRI_FTSENSOR_SDK_DECL bool CommEthernet::onEventLoop(const boost::function<bool()> &task) {
+        bool running;
+        {
+            std::lock_guard<std::mutex> lock(_ioMutex);
+            running = _ioThread.joinable();
+        }
+        if (!running || _io.get_executor().running_in_this_thread())
+            return task();
+
+        std::promise<bool> done;
+        _io.post([&done, &task]() { done.set_value(task()); });
+        return done.get_future().get();
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::startEventLoop() {
+        std::lock_guard<std::mutex> lock(_ioMutex);
+        if (_ioThread.joinable())
+            return;
+        _work.reset(new io_service::work(_io));
+        _ioThread = std::thread([this]() { _io.run(); });
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::startTransaction() {
+        std::shared_ptr<Transaction> transaction = _transactions.front();
+
+        _timer.expires_after(std::chrono::milliseconds(transaction->Timeout));
+        _timer.async_wait([this, transaction](const boost::system::error_code &error) {
+            if (!error && !transaction->Done)
+                _socket.cancel(); // completes the pending operation with operation_aborted
+        });
+
+        async_write(_socket, buffer(transaction->Command),
+                    [this, transaction](const boost::system::error_code &error, size_t) {
+            if (error) {
+                finishTransaction(false, 0);
+                return;
+            }
+            readResponse(transaction);
+        });
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::readResponse(const std::shared_ptr<Transaction> &transaction) {
+        async_read_until(_socket, _response, "\r\n",
+                         [this, transaction](const boost::system::error_code &error, size_t n) {
+            if (!error && !transaction->Echo.empty()) {
+                size_t size = std::min(n, transaction->Echo.size());
+                std::string echo(buffers_begin(_response.data()), buffers_begin(_response.data()) + size);
+                if (echo != transaction->Echo) {
+                    SRI_LOG(Warning, "SRI::ETHERNET::Dropped a response not matching %s", transaction->Echo.c_str());
+                    _response.consume(n);
+                    readResponse(transaction); // still within the timeout of the transaction
+                    return;
+                }
+            }
+            finishTransaction(!error, n);
+        });
+    }
+
+    SRI_FTSENSOR_SDK_DECL void CommEthernet::finishTransaction(bool ok, size_t n) {
+        std::shared_ptr<Transaction> transaction = _transactions.front();
+        transaction->Done = true;
+        _timer.cancel();
+
+        FrameBuffer response;
+        if (ok) {
+            response.resize(n);
+            buffer_copy(buffer(response.data(), n), _response.data());
+            _response.consume(n);
+        } else {
+            _response.consume(_response.size()); // partial response of a failed transaction
+        }
+        transaction->Handler(ok, response);
+
+        _transactions.pop_front();
+        if (!_transactions.empty())
+            startTransaction();
+    }
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_IMPL_COMMETHERNET_IPP
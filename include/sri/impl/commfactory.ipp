@@ -0,0 +1,31 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_IMPL_COMMFACTORY_IPP
+#define SRI_FTSENSOR_SDK_IMPL_COMMFACTORY_IPP
+
+#include <sri/commfactory.hpp>
+#include <sri/commethernet.hpp>
+
+namespace SRI {
+    SRI_FTSENSOR_SDK_DECL SensorComm *createCommEthernet(const std::string &ip, uint16_t port) {
+        return new CommEthernet(ip, port);
+    }
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_IMPL_COMMFACTORY_IPP
@@ -0,0 +1,592 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_IMPL_FTSENSOR_IPP
+#define SRI_FTSENSOR_SDK_IMPL_FTSENSOR_IPP
+
+#include <sri/ftsensor.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/format.hpp>
+#include <boost/crc.hpp> //crc32
+#include <boost/thread.hpp>
+
+namespace SRI {
+    SRI_FTSENSOR_SDK_DECL IpAddr FTSensor::getIpAddress() {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return IpAddr();
+        }
+
+        commPtr->write(generateCommandBuffer(EIP, "?"));
+
+        int waitTime = 0;
+        while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+            waitTime++;
+        }
+
+        FrameBuffer &recvbuf = readResponse();
+        std::string response = extractResponseBuffer(recvbuf, EIP, "?");
+
+        return response;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setIpAddress(const IpAddr &ip) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(EIP, ip));
+
+        int waitTime = 0;
+        while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+            waitTime++;
+        }
+
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), EIP) == ParseError::None)
+            return true;
+        else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL MacAddr FTSensor::getMacAddress() {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return MacAddr();
+        }
+
+        commPtr->write(generateCommandBuffer(EMAC, "?"));
+
+        int waitTime = 0;
+        while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+            waitTime++;
+        }
+
+        FrameBuffer &recvbuf = readResponse();
+        std::string response = extractResponseBuffer(recvbuf, EMAC, "?");
+
+        return response;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setMacAddress(const MacAddr &mac) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(EMAC, mac));
+
+        int waitTime = 0;
+        while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+            waitTime++;
+        }
+
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), EMAC) == ParseError::None)
+            return true;
+        else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL GateAddr FTSensor::getGateWay() {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return GateAddr();
+        }
+
+        commPtr->write(generateCommandBuffer(EGW, "?"));
+
+        int waitTime = 0;
+        while (commPtr->available() == 0 && waitTime < WAIT_TIME) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+            waitTime++;
+        }
+
+        FrameBuffer &recvbuf = readResponse();
+        std::string response = extractResponseBuffer(recvbuf, EGW, "?");
+
+        return response;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setGateWay(const GateAddr &gate) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(EGW, gate));
+
+        while (commPtr->available() == 0 && commPtr->isValid()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), EGW) == ParseError::None)
+            return true;
+        else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL NetMask FTSensor::getNetMask() {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return NetMask();
+        }
+
+        commPtr->write(generateCommandBuffer(ENM, "?"));
+        while (commPtr->available() == 0 && commPtr->isValid()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        std::string response = extractResponseBuffer(recvbuf, ENM, "?");
+
+        return response;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setNetMask(const NetMask &mask) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(ENM, mask));
+
+        while (commPtr->available() == 0 && commPtr->isValid()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), ENM) == ParseError::None)
+            return true;
+        else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::getChannelGains(Gains &gains, ParseError &error) {
+        boost::string_view payload;
+        error = queryResponse(CHNAPG, payload);
+        if (error == ParseError::None)
+            error = parseFloatList(payload, ';', gains);
+        return error == ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL Gains FTSensor::getChannelGains() {
+        Gains gains;
+        ParseError error;
+        if (!getChannelGains(gains, error)) {
+            SRI_LOG(Error, "ERROR::FTSensor::getChannelGains():%s", toString(error));
+            return Gains();
+        }
+
+        return gains;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::getSamplingRate(SampleRate &rate, ParseError &error) {
+        boost::string_view payload;
+        uint32_t value = 0;
+        error = queryResponse(SMPR, payload);
+        if (error == ParseError::None)
+            error = parseUnsigned(payload, value, std::numeric_limits<SampleRate>::max());
+        if (error != ParseError::None)
+            return false;
+
+        rate = SampleRate(value);
+        samplingRate = rate;
+        return true;
+    }
+
+    SRI_FTSENSOR_SDK_DECL SampleRate FTSensor::getSamplingRate() {
+        SampleRate rate;
+        ParseError error;
+        if (!getSamplingRate(rate, error)) {
+            SRI_LOG(Error, "ERROR::FTSensor::getSamplingRate():%s", toString(error));
+            return SampleRate();
+        }
+
+        return rate;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setSamplingRate(SampleRate rate) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(SMPR, boost::lexical_cast<std::string>(rate)));
+
+        while (commPtr->available() == 0 && commPtr->isValid() == true) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), SMPR) == ParseError::None) {
+            rememberConfig(SMPR, boost::lexical_cast<std::string>(rate));
+            samplingRate = rate;
+            return true;
+        } else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::getExcitationVoltages(Voltages &voltages, ParseError &error) {
+        boost::string_view payload;
+        error = queryResponse(EXMV, payload);
+        if (error == ParseError::None)
+            error = parseFloatList(payload, ';', voltages);
+        return error == ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL Voltages FTSensor::getExcitationVoltages() {
+        Voltages voltages;
+        ParseError error;
+        if (!getExcitationVoltages(voltages, error)) {
+            SRI_LOG(Error, "ERROR::FTSensor::getExcitationVoltages():%s", toString(error));
+            return Voltages();
+        }
+
+        return voltages;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::getSensorSensitivities(Sensitivities &sens, ParseError &error) {
+        boost::string_view payload;
+        error = queryResponse(SENS, payload);
+        if (error == ParseError::None)
+            error = parseFloatList(payload, ';', sens);
+        return error == ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL Sensitivities FTSensor::getSensorSensitivities() {
+        Sensitivities sens;
+        ParseError error;
+        if (!getSensorSensitivities(sens, error)) {
+            SRI_LOG(Error, "ERROR::FTSensor::getSensorSensitivities():%s", toString(error));
+            return Sensitivities();
+        }
+
+        return sens;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setSensorSensitivities(const Sensitivities &sens) {
+        std::string parameters;
+        for (auto &s : sens) {
+            parameters += boost::lexical_cast<std::string>(s) + ";";
+        }
+        parameters = parameters.substr(0, parameters.find_last_of(';'));
+
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(SENS, parameters));
+
+        while (commPtr->available() == 0 && commPtr->isValid() == true) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), SENS) == ParseError::None) {
+            rememberConfig(SENS, parameters);
+            return true;
+        } else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::getAmplifierZeroOffsets(Offsets &offsets, ParseError &error) {
+        boost::string_view payload;
+        error = queryResponse(AMPZ, payload);
+        if (error == ParseError::None)
+            error = parseFloatList(payload, ';', offsets);
+        return error == ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL Offsets FTSensor::getAmplifierZeroOffsets() {
+        Offsets offsets;
+        ParseError error;
+        if (!getAmplifierZeroOffsets(offsets, error)) {
+            SRI_LOG(Error, "ERROR::FTSensor::getAmplifierZeroOffsets():%s", toString(error));
+            return Offsets();
+        }
+
+        return offsets;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setAmplifierZeroOffsets(const Offsets &offsets) {
+        SRI_LOG(Warning, "SRI::FTSensor::setAmplifierZeroOffsets::Has not been implemented.");
+        return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::getRealTimeDataMode(RTDataMode &rtDataMode, ParseError &error) {
+        boost::string_view payload;
+        error = queryResponse(SGDM, payload);
+        if (error == ParseError::None)
+            error = parseRealTimeDataMode(payload, rtDataMode);
+        return error == ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL RTDataMode FTSensor::getRealTimeDataMode() {
+        RTDataMode rtDataMode;
+        ParseError error;
+        if (!getRealTimeDataMode(rtDataMode, error)) {
+            SRI_LOG(Error, "ERROR::FTSensor::getRealTimeDataMode():%s", toString(error));
+            return RTDataMode();
+        }
+
+        return rtDataMode;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setRealTimeDataMode(const RTDataMode &rtDataMode) {
+        //format (A02,A03,A04,A01,A05,A06);C;1;(WMA:1,1,2,3)
+        //1.
+        std::string parameters;
+        parameters += "(";
+        for (auto &c : rtDataMode.channelOrder) {
+            parameters += boost::str(boost::format("A%02d,") % c);
+        }
+        boost::trim_right_if(parameters, boost::is_any_of(","));
+        parameters += ");";
+        //2.
+        parameters += rtDataMode.DataUnit;
+        parameters += ";";
+        //3.
+        parameters += std::to_string(rtDataMode.PNpCH);
+        parameters += ";";
+        //4.
+        std::string weights;
+        for (auto &w : rtDataMode.filterWeights) {
+            weights += boost::str(boost::format("%d,") % w);
+        }
+        boost::trim_right_if(weights, boost::is_any_of(","));
+        parameters += boost::str(boost::format("(%s:%s)") % rtDataMode.FM % weights);
+
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(SGDM, parameters));
+        while (commPtr->available() == 0 && commPtr->isValid() == true) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), SGDM) == ParseError::None) {
+            rememberConfig(SGDM, parameters);
+            return true;
+        } else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL RTDataValid FTSensor::getRealTimeDataValid() {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return RTDataValid();
+        }
+
+        commPtr->write(generateCommandBuffer(DCKMD, "?"));
+
+        while (commPtr->available() == 0 && commPtr->isValid()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        std::string response = extractResponseBuffer(recvbuf, DCKMD, "?");
+
+        return response;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::setRealTimeDataValid(const RTDataValid &rtDataValid) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        commPtr->write(generateCommandBuffer(DCKMD, rtDataValid));
+
+        while (commPtr->available() == 0 && commPtr->isValid() == true) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        if (parseSetResponse(recvbuf.data(), recvbuf.size(), DCKMD) == ParseError::None) {
+            rememberConfig(DCKMD, rtDataValid);
+            return true;
+        } else
+            return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::reconnect() {
+        if (!commPtr->reconnect())
+            return false;
+        return replayConfig();
+    }
+
+    SRI_FTSENSOR_SDK_DECL void FTSensor::stopRealTimeDataRepeatedly() {
+        isRepeatedly = false; // first, a receiving thread trying to reconnect ends as well
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return;
+        }
+
+        commPtr->write("AT+GSD=STOP\r\n");
+
+        SRI_LOG(Info, "Stop real time data repeatedly");
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::waitRealTimeDataFinished(uint32_t timeoutMs) {
+        return waitRealTimeDataStopped(timeoutMs);
+    }
+
+    SRI_FTSENSOR_SDK_DECL std::string FTSensor::generateCommandBuffer(const std::string &command,
+                                                                      const std::string &parameter) {
+        return AT + command + "=" + parameter + "\r\n";
+    }
+
+    SRI_FTSENSOR_SDK_DECL std::string FTSensor::extractResponseBuffer(const FrameBuffer &buf, const std::string &command,
+                                                                      const std::string &parameter) {
+        Response response;
+        if (parseResponse(buf.data(), buf.size(), command, response) != ParseError::None)
+            return "";
+        boost::string_view result = parameter == "?" ? response.Payload : response.Code;
+
+        return std::string(result.data(), result.size());
+    }
+
+    SRI_FTSENSOR_SDK_DECL void FTSensor::rememberConfig(const std::string &command, const std::string &parameter) {
+        std::lock_guard<std::mutex> lock(configMutex);
+        for (auto &setting : sensorConfig) {
+            if (setting.first == command) {
+                setting.second = parameter;
+                return;
+            }
+        }
+        sensorConfig.emplace_back(command, parameter);
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::replayConfig() {
+        std::vector<std::pair<std::string, std::string>> config;
+        {
+            std::lock_guard<std::mutex> lock(configMutex);
+            config = sensorConfig;
+        }
+        for (auto &setting : config) {
+            commPtr->write(generateCommandBuffer(setting.first, setting.second));
+
+            int waitTime = 0;
+            while (commPtr->available() == 0 && commPtr->isValid() && waitTime < ASYNC_TIMEOUT_MS * 1000 / DELAY_US) {
+                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+                waitTime++;
+            }
+            FrameBuffer &recvbuf = readResponse();
+            if (parseSetResponse(recvbuf.data(), recvbuf.size(), setting.first) != ParseError::None) {
+                SRI_LOG(Error, "ERROR::FTSensor::reconnect():%s=%s was not accepted",
+                        setting.first.c_str(), setting.second.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::resumeRealTimeData() {
+        while (isRepeatedly) {
+            SRI_LOG(Warning, "SRI::REAL-TIME::Connection lost, reconnecting");
+            if (reconnect()) {
+                commPtr->write("AT+GSD\r\n");
+                SRI_LOG(Info, "SRI::REAL-TIME::Reconnected, real time data resumed");
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(reconnectRetryMs));
+        }
+        return false;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError FTSensor::queryResponse(const std::string &command, boost::string_view &payload) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return ParseError::NoResponse;
+        }
+
+        commPtr->write(generateCommandBuffer(command, "?"));
+
+        while (commPtr->available() == 0 && commPtr->isValid()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        FrameBuffer &recvbuf = readResponse();
+        if (recvbuf.empty())
+            return ParseError::NoResponse;
+        return parseQueryResponse(recvbuf.data(), recvbuf.size(), command, payload);
+    }
+
+    SRI_FTSENSOR_SDK_DECL FrameBuffer &FTSensor::readResponse() {
+        static thread_local FrameBuffer responseBuffer;
+        responseBuffer.clear();
+        commPtr->read(responseBuffer);
+        return responseBuffer;
+    }
+
+    SRI_FTSENSOR_SDK_DECL uint32_t FTSensor::getCRC32(const int8_t *pData, size_t len) {
+        boost::crc_32_type crc32;
+        crc32.process_bytes(pData, len);
+
+        return crc32.checksum();
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::beginRealTimeData(const RTDataMode &rtMode) {
+        if (!commPtr->isValid()) {
+            SRI_LOG(Error, "ERROR::Communication is not valid");
+            return false;
+        }
+
+        announceRealTimeDataMode(rtMode);
+        commPtr->write("AT+GSD\r\n");
+
+        isRepeatedly = true;
+        rtWorkers++; // the caller starts realTimeDataWorker
+        return true;
+    }
+
+    SRI_FTSENSOR_SDK_DECL bool FTSensor::waitRealTimeDataStopped(uint32_t timeoutMs) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (rtWorkers > 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+        }
+        if (rtWorkers > 0) {
+            SRI_LOG(Error, "ERROR::FTSensor::waitRealTimeDataStopped():Real time data threads still running after %u ms",
+                    unsigned(timeoutMs));
+            return false;
+        }
+        // the sensor may still be sending, discard until the link has been quiet for WAIT_TIME * DELAY_US
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        int quiet = 0;
+        while (quiet < WAIT_TIME && commPtr->isValid() && std::chrono::steady_clock::now() < deadline) {
+            if (commPtr->available() > 0) {
+                readResponse();
+                quiet = 0;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(DELAY_US));
+                quiet++;
+            }
+        }
+        return true;
+    }
+
+    SRI_FTSENSOR_SDK_DECL void FTSensor::startThread(const boost::function<void()> &body) {
+        boost::thread(body).detach();
+    }
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_IMPL_FTSENSOR_IPP
@@ -0,0 +1,231 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_IMPL_RESPONSEPARSER_IPP
+#define SRI_FTSENSOR_SDK_IMPL_RESPONSEPARSER_IPP
+
+#include <sri/responseparser.hpp>
+
+#include <cmath>
+
+namespace SRI {
+    SRI_FTSENSOR_SDK_DECL ParseError parseResponse(const int8_t *data, size_t size, boost::string_view command, Response &response) {
+        boost::string_view s(reinterpret_cast<const char *>(data), size);
+        boost::string_view ack(ACK);
+        if (s.substr(0, ack.size()) != ack)
+            return ParseError::NoHeader;
+        s.remove_prefix(ack.size());
+        size_t eq = s.find('=');
+        if (eq == boost::string_view::npos)
+            return ParseError::Truncated;
+        if (s.substr(0, eq) != command)
+            return ParseError::WrongCommand;
+        s.remove_prefix(eq + 1);
+        size_t dollar = s.find('$');
+        if (dollar == boost::string_view::npos)
+            return ParseError::Truncated;
+        size_t end = s.find("\r\n", dollar);
+        if (end == boost::string_view::npos)
+            return ParseError::Truncated;
+        response.Payload = s.substr(0, dollar);
+        response.Code = s.substr(dollar + 1, end - dollar - 1);
+        return ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseQueryResponse(const int8_t *data, size_t size, boost::string_view command,
+                                                        boost::string_view &payload) {
+        Response response;
+        ParseError error = parseResponse(data, size, command, response);
+        if (error != ParseError::None)
+            return error;
+        if (response.Code != RES_OK)
+            return ParseError::NotOk;
+        payload = response.Payload;
+        return ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseSetResponse(const int8_t *data, size_t size, boost::string_view command) {
+        Response response;
+        ParseError error = parseResponse(data, size, command, response);
+        if (error != ParseError::None)
+            return error;
+        return response.Code == RES_OK ? ParseError::None : ParseError::NotOk;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseUnsigned(boost::string_view text, uint32_t &value,
+                                                   uint32_t maximum) {
+        if (text.empty())
+            return ParseError::BadNumber;
+        uint64_t v = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9')
+                return ParseError::BadNumber;
+            v = v * 10 + (c - '0');
+            if (v > maximum)
+                return ParseError::BadNumber;
+        }
+        value = uint32_t(v);
+        return ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseFloat(boost::string_view text, float &value) {
+        size_t i = 0, n = text.size();
+        bool negative = false;
+        if (i < n && (text[i] == '+' || text[i] == '-'))
+            negative = text[i++] == '-';
+
+        uint64_t mantissa = 0;
+        int exponent = 0, digits = 0, significant = 0;
+        for (; i < n && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (text[i] - '0');
+                significant += mantissa != 0;
+            } else {
+                exponent++; // beyond the precision of the mantissa
+            }
+        }
+        if (i < n && text[i] == '.') {
+            for (i++; i < n && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+                if (significant < 19) {
+                    mantissa = mantissa * 10 + (text[i] - '0');
+                    significant += mantissa != 0;
+                    exponent--;
+                }
+            }
+        }
+        if (digits == 0)
+            return ParseError::BadNumber;
+        if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+            i++;
+            bool negativeExp = false;
+            if (i < n && (text[i] == '+' || text[i] == '-'))
+                negativeExp = text[i++] == '-';
+            uint32_t e = 0;
+            size_t start = i;
+            while (i < n && text[i] >= '0' && text[i] <= '9')
+                i++;
+            if (parseUnsigned(text.substr(start, i - start), e, 400) != ParseError::None)
+                return ParseError::BadNumber;
+            exponent += negativeExp ? -int(e) : int(e);
+        }
+        if (i != n)
+            return ParseError::BadNumber;
+
+        double v = double(mantissa) * std::pow(10.0, exponent);
+        if (v > std::numeric_limits<float>::max())
+            return ParseError::BadNumber;
+        value = float(negative ? -v : v);
+        return ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseFloatList(boost::string_view text, char delimiter, std::vector<float> &values) {
+        values.clear();
+        Tokenizer tokens(text, delimiter);
+        boost::string_view token;
+        while (tokens.next(token)) {
+            if (token.empty())
+                continue;
+            float v;
+            if (parseFloat(token, v) != ParseError::None)
+                return ParseError::BadNumber;
+            values.push_back(v);
+        }
+        return values.empty() ? ParseError::BadFormat : ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseFloatList(boost::string_view text, std::vector<float> &values) {
+        return parseFloatList(text, ';', values);
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseText(boost::string_view text, std::string &value) {
+        value.assign(text.data(), text.size());
+        return ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseSampleRate(boost::string_view text, SampleRate &rate) {
+        uint32_t value;
+        ParseError error = parseUnsigned(text, value, std::numeric_limits<SampleRate>::max());
+        if (error == ParseError::None)
+            rate = SampleRate(value);
+        return error;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError stripParentheses(boost::string_view &text) {
+        if (text.size() < 2 || text.front() != '(' || text.back() != ')')
+            return ParseError::BadFormat;
+        text = text.substr(1, text.size() - 2);
+        return ParseError::None;
+    }
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseRealTimeDataMode(boost::string_view text, RTDataMode &rtDataMode) {
+        boost::string_view fields[4];
+        size_t nFields = 0;
+        Tokenizer tokens(text, ';');
+        boost::string_view token;
+        while (tokens.next(token)) {
+            if (nFields == 4)
+                return ParseError::BadFormat;
+            fields[nFields++] = token;
+        }
+        if (nFields != 4)
+            return ParseError::BadFormat;
+
+        //1. The relevant analog channels
+        boost::string_view channels = fields[0];
+        if (stripParentheses(channels) != ParseError::None)
+            return ParseError::BadFormat;
+        rtDataMode.channelOrder.clear();
+        Tokenizer channelTokens(channels, ',');
+        while (channelTokens.next(token)) {
+            uint32_t c;
+            if (token.empty() || token.front() != 'A')
+                return ParseError::BadFormat;
+            if (parseUnsigned(token.substr(1), c, std::numeric_limits<uint16_t>::max()) != ParseError::None)
+                return ParseError::BadNumber;
+            rtDataMode.channelOrder.push_back(uint16_t(c));
+        }
+        //2. The unit of data
+        if (fields[1].size() != 1 || rtDataMode.UnitLength.count(fields[1][0]) == 0)
+            return ParseError::BadFormat;
+        rtDataMode.DataUnit = fields[1][0];
+        //3. Number of data per channel
+        uint32_t pnpch;
+        if (parseUnsigned(fields[2], pnpch, std::numeric_limits<uint16_t>::max()) != ParseError::None)
+            return ParseError::BadNumber;
+        rtDataMode.PNpCH = uint16_t(pnpch);
+        //4. Filter model and its weights
+        boost::string_view filter = fields[3];
+        if (stripParentheses(filter) != ParseError::None)
+            return ParseError::BadFormat;
+        size_t colon = filter.find(':');
+        if (colon == 0 || colon == boost::string_view::npos)
+            return ParseError::BadFormat;
+        rtDataMode.FM.assign(filter.data(), colon);
+        rtDataMode.filterWeights.clear();
+        Tokenizer weightTokens(filter.substr(colon + 1), ',');
+        while (weightTokens.next(token)) {
+            uint32_t w;
+            if (parseUnsigned(token, w, std::numeric_limits<uint16_t>::max()) != ParseError::None)
+                return ParseError::BadNumber;
+            rtDataMode.filterWeights.push_back(uint16_t(w));
+        }
+        return ParseError::None;
+    }
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_IMPL_RESPONSEPARSER_IPP
@@ -0,0 +1,331 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_LOGGER_HPP
+#define SRI_FTSENSOR_SDK_LOGGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Log a printf-style message at SRI::LogLevel::level, rate limited per call site, e.g.
+/// SRI_LOG(Error, "SRI::SHM::Error mapping shared memory %s", name.c_str());
+#define SRI_LOG(level, ...) \
+    do { \
+        static ::SRI::LogSite sriLogSite; \
+        ::SRI::Logger::instance().log(sriLogSite, ::SRI::LogLevel::level, __VA_ARGS__); \
+    } while (0)
+
+namespace SRI {
+    const size_t LOG_MESSAGE_SIZE = 256;     // maximum length of a message, longer messages are truncated
+    const size_t LOG_QUEUE_CAPACITY = 1024;  // number of messages waiting for the sink
+
+    enum class LogLevel {
+        Debug,
+        Info,
+        Warning,
+        Error,
+        Off
+    };
+
+    inline const char *toString(LogLevel level) {
+        switch (level) {
+            case LogLevel::Debug: return "DEBUG";
+            case LogLevel::Info: return "INFO";
+            case LogLevel::Warning: return "WARNING";
+            case LogLevel::Error: return "ERROR";
+            default: return "OFF";
+        }
+    }
+
+    struct LogRecord {
+        uint64_t Timestamp = 0;             // steady clock in ns
+        LogLevel Level = LogLevel::Info;
+        uint32_t Suppressed = 0;            // messages of the same site dropped by the rate limit before this one
+        char Message[LOG_MESSAGE_SIZE] = {};
+    };
+
+    struct LogCounters {
+        uint64_t Messages[int(LogLevel::Off)] = {}; // messages per level, counted before filtering
+        uint64_t Suppressed = 0;                    // dropped by the per-site rate limit
+        uint64_t Overflowed = 0;                    // dropped because the sink could not keep up
+    };
+
+    /// Destination of log messages, called by the logging thread only
+    class LogSink {
+    public:
+        virtual ~LogSink() = default;
+
+        virtual void write(const LogRecord &record) = 0;
+    }; // class LogSink
+
+    /// Default sink, prints the messages as the SDK always did
+    class ConsoleSink : public LogSink {
+    public:
+        void write(const LogRecord &record) override {
+            std::cout << record.Message;
+            if (record.Suppressed > 0)
+                std::cout << " (" << record.Suppressed << " similar messages suppressed)";
+            std::cout << std::endl;
+        }
+    }; // class ConsoleSink
+
+    /// Rate limit state of one call site, see SRI_LOG
+    struct LogSite {
+        std::atomic<uint64_t> WindowStart{0};   // start of the current window in ns
+        std::atomic<uint32_t> Count{0};         // messages in the current window
+        std::atomic<uint32_t> Suppressed{0};    // messages suppressed since the last one written
+    };
+
+    /// Bounded lock-free multi-producer queue of log records (D. Vyukov's bounded MPMC queue)
+    class LogQueue {
+    public:
+        explicit LogQueue(size_t capacity) : _cells(capacity), _mask(capacity - 1) {
+            for (size_t i = 0; i < capacity; i++)
+                _cells[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+
+        /// \return false if the queue is full
+        bool push(const LogRecord &record) {
+            size_t pos = _tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell &cell = _cells[pos & _mask];
+                size_t seq = cell.Sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(seq) - intptr_t(pos);
+                if (diff == 0) {
+                    if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.Record = record;
+                        cell.Sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = _tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(LogRecord &record) {
+            size_t pos = _head.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell &cell = _cells[pos & _mask];
+                size_t seq = cell.Sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+                if (diff == 0) {
+                    if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        record = cell.Record;
+                        cell.Sequence.store(pos + _mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = _head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> Sequence;
+            LogRecord Record;
+        };
+
+        std::vector<Cell> _cells;               // capacity is a power of two
+        size_t _mask;
+        alignas(64) std::atomic<size_t> _tail{0};
+        alignas(64) std::atomic<size_t> _head{0};
+    }; // class LogQueue
+
+    /// Process-wide logger. Messages are formatted into a fixed-size record by the caller and
+    /// written by a background thread, so logging never waits for the sink.
+    class Logger {
+    public:
+        static Logger &instance() {
+            static Logger logger;
+            return logger;
+        }
+
+        ~Logger() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _running = false;
+            }
+            _wakeup.notify_one();
+            if (_thread.joinable())
+                _thread.join();
+            drain();
+        }
+
+        /// Replace the sink, nullptr for the console
+        void setSink(std::shared_ptr<LogSink> sink) {
+            if (!sink)
+                sink = std::make_shared<ConsoleSink>();
+            std::lock_guard<std::mutex> lock(_sinkMutex);
+            _sink = sink;
+        }
+
+        /// Messages below level are counted but not written
+        void setLevel(LogLevel level) {
+            _level = level;
+        }
+
+        LogLevel getLevel() const {
+            return _level;
+        }
+
+        /// Maximum number of messages per call site and second, 0 for no limit
+        void setRateLimit(uint32_t perSecond) {
+            _rateLimit = perSecond;
+        }
+
+        /// Write messages in the calling thread instead of the background thread
+        void setAsync(bool async) {
+            _async = async;
+            if (!async)
+                flush();
+        }
+
+        LogCounters getCounters() const {
+            LogCounters counters;
+            for (int i = 0; i < int(LogLevel::Off); i++)
+                counters.Messages[i] = _messages[i];
+            counters.Suppressed = _suppressed;
+            counters.Overflowed = _overflowed;
+            return counters;
+        }
+
+        /// Write all queued messages before returning
+        void flush() {
+            drain();
+        }
+
+        void log(LogSite &site, LogLevel level, const char *format, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 4, 5)))
+#endif
+        {
+            if (level >= LogLevel::Off)
+                return;
+            _messages[int(level)].fetch_add(1, std::memory_order_relaxed);
+            if (level < _level)
+                return;
+
+            uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+            uint32_t limit = _rateLimit;
+            if (limit > 0) {
+                uint64_t start = site.WindowStart.load(std::memory_order_relaxed);
+                if (now - start >= 1000000000ull && site.WindowStart.compare_exchange_strong(start, now)) {
+                    site.Count = 0;
+                }
+                if (site.Count.fetch_add(1, std::memory_order_relaxed) >= limit) {
+                    site.Suppressed.fetch_add(1, std::memory_order_relaxed);
+                    _suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            LogRecord record;
+            record.Timestamp = now;
+            record.Level = level;
+            record.Suppressed = site.Suppressed.exchange(0, std::memory_order_relaxed);
+            va_list args;
+            va_start(args, format);
+            std::vsnprintf(record.Message, LOG_MESSAGE_SIZE, format, args);
+            va_end(args);
+
+            if (!_async) {
+                std::lock_guard<std::mutex> lock(_sinkMutex);
+                _sink->write(record);
+                return;
+            }
+            if (!_queue.push(record)) {
+                _overflowed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            startThread();
+            if (_sleeping.load(std::memory_order_acquire))
+                _wakeup.notify_one();
+        }
+
+    private:
+        Logger() : _queue(LOG_QUEUE_CAPACITY), _sink(std::make_shared<ConsoleSink>()) {}
+
+        Logger(const Logger &) = delete;
+        Logger &operator=(const Logger &) = delete;
+
+        void startThread() {
+            if (_started.load(std::memory_order_acquire))
+                return;
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_started) {
+                _running = true;
+                _thread = std::thread(&Logger::run, this);
+                _started = true;
+            }
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_running) {
+                lock.unlock();
+                drain();
+                lock.lock();
+                _sleeping = true;
+                // the timeout covers a wakeup missed between drain() and setting _sleeping
+                _wakeup.wait_for(lock, std::chrono::milliseconds(10));
+                _sleeping = false;
+            }
+        }
+
+        void drain() {
+            std::lock_guard<std::mutex> lock(_sinkMutex);
+            LogRecord record;
+            while (_queue.pop(record))
+                _sink->write(record);
+        }
+
+        LogQueue _queue;                                    // records waiting for the sink
+        std::shared_ptr<LogSink> _sink;                     // guarded by _sinkMutex
+        std::mutex _sinkMutex;
+        std::atomic<LogLevel> _level{LogLevel::Debug};
+        std::atomic<uint32_t> _rateLimit{10};
+        std::atomic<bool> _async{true};
+        std::atomic<uint64_t> _messages[int(LogLevel::Off)] = {};
+        std::atomic<uint64_t> _suppressed{0};
+        std::atomic<uint64_t> _overflowed{0};
+        std::atomic<bool> _started{false};                  // background thread has been started
+        std::atomic<bool> _sleeping{false};                 // background thread is waiting for _wakeup
+        bool _running = false;                              // guarded by _mutex
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        std::thread _thread;
+    }; // class Logger
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_LOGGER_HPP
@@ -0,0 +1,134 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_RESPONSEPARSER_HPP
+#define SRI_FTSENSOR_SDK_RESPONSEPARSER_HPP
+
+#include <sri/config.hpp>
+#include <sri/types.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace SRI {
+    enum class ParseError {
+        None,
+        NoResponse,     // nothing was received, e.g. the communication is not valid
+        NoHeader,       // the response does not start with ACK+
+        WrongCommand,   // the response belongs to another command
+        Truncated,      // '=', '$' or "\r\n" is missing
+        NotOk,          // the response code is not OK
+        BadNumber,      // a number is malformed or out of range
+        BadFormat       // the payload does not match the expected structure
+    };
+
+    inline const char *toString(ParseError error) {
+        switch (error) {
+            case ParseError::None: return "no error";
+            case ParseError::NoResponse: return "no response";
+            case ParseError::NoHeader: return "response does not start with ACK+";
+            case ParseError::WrongCommand: return "response to another command";
+            case ParseError::Truncated: return "response is truncated";
+            case ParseError::NotOk: return "response code is not OK";
+            case ParseError::BadNumber: return "malformed number";
+            case ParseError::BadFormat: return "malformed payload";
+        }
+        return "unknown error";
+    }
+
+    /// Views into a response ACK+<command>=<payload>$<code>\r\n, valid as long as the received buffer
+    struct Response {
+        boost::string_view Payload;
+        boost::string_view Code;
+    };
+
+    /// Split a text at a delimiter without copying
+    class Tokenizer {
+    public:
+        Tokenizer(boost::string_view text, char delimiter) : _text(text), _delimiter(delimiter) {}
+
+        /// Get the next token, empty tokens included
+        /// \param[out] token   The token
+        /// \return             false if there are no more tokens
+        bool next(boost::string_view &token) {
+            if (_done)
+                return false;
+            size_t end = _text.find(_delimiter);
+            if (end == boost::string_view::npos) {
+                token = _text;
+                _done = true;
+            } else {
+                token = _text.substr(0, end);
+                _text.remove_prefix(end + 1);
+            }
+            return true;
+        }
+
+    private:
+        boost::string_view _text;   // rest of the text
+        char _delimiter;
+        bool _done = false;         // the last token has been returned
+    }; // class Tokenizer
+
+    /// Parse a complete response
+    /// \param[in] data      The received bytes, may be followed by other data
+    /// \param[in] size      The number of received bytes
+    /// \param[in] command   The expected command, e.g. SMPR
+    /// \param[out] response The payload and the response code
+    SRI_FTSENSOR_SDK_DECL ParseError parseResponse(const int8_t *data, size_t size, boost::string_view command, Response &response);
+
+    /// Parse the response to a query (AT+<command>=?), which has to be answered with OK
+    SRI_FTSENSOR_SDK_DECL ParseError parseQueryResponse(const int8_t *data, size_t size, boost::string_view command,
+                                                        boost::string_view &payload);
+
+    /// Parse the response to a setting (AT+<command>=<value>), accepted if answered with OK
+    SRI_FTSENSOR_SDK_DECL ParseError parseSetResponse(const int8_t *data, size_t size, boost::string_view command);
+
+    /// Parse a decimal unsigned integer, the whole text has to be consumed
+    SRI_FTSENSOR_SDK_DECL ParseError parseUnsigned(boost::string_view text, uint32_t &value,
+                                                   uint32_t maximum = std::numeric_limits<uint32_t>::max());
+
+    /// Parse a decimal floating point number [+-]digits[.digits][(e|E)[+-]digits], the whole text has to be consumed
+    SRI_FTSENSOR_SDK_DECL ParseError parseFloat(boost::string_view text, float &value);
+
+    /// Parse a list of numbers such as 1.0;2.0;3.0, empty entries are skipped
+    SRI_FTSENSOR_SDK_DECL ParseError parseFloatList(boost::string_view text, char delimiter, std::vector<float> &values);
+
+    /// Parse a list of numbers separated by ';'
+    SRI_FTSENSOR_SDK_DECL ParseError parseFloatList(boost::string_view text, std::vector<float> &values);
+
+    /// Copy a payload that is used as it is, e.g. an IP address
+    SRI_FTSENSOR_SDK_DECL ParseError parseText(boost::string_view text, std::string &value);
+
+    SRI_FTSENSOR_SDK_DECL ParseError parseSampleRate(boost::string_view text, SampleRate &rate);
+
+    /// Remove the enclosing parentheses of (text)
+    SRI_FTSENSOR_SDK_DECL ParseError stripParentheses(boost::string_view &text);
+
+    /// Parse the real time data mode, format: (A01,A02,A03,A04,A05,A06);C;1;(WMA:1,1,2,3)
+    SRI_FTSENSOR_SDK_DECL ParseError parseRealTimeDataMode(boost::string_view text, RTDataMode &rtDataMode);
+} //namespace SRI
+
+#ifndef SRI_FTSENSOR_SDK_SEPARATE_COMPILATION
+#include <sri/impl/responseparser.ipp>
+#endif
+
+
+#endif //SRI_FTSENSOR_SDK_RESPONSEPARSER_HPP
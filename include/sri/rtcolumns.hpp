@@ -0,0 +1,303 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_RTCOLUMNS_HPP
+#define SRI_FTSENSOR_SDK_RTCOLUMNS_HPP
+
+#include <sri/types.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+#include <boost/align/aligned_alloc.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace SRI {
+    const size_t RT_COLUMN_ALIGNMENT = 32; // byte alignment of every column, enough for AVX loads
+
+    /// Convert a decoded value to a floating point data format
+    template<typename T>
+    inline typename std::enable_if<std::is_floating_point<T>::value, T>::type fromColumnValue(float value) {
+        return static_cast<T>(value);
+    }
+
+    /// Convert a decoded value to an integral data format, rounded and clamped to its range:
+    /// after a tare, AD counts below the bias are negative
+    template<typename T>
+    inline typename std::enable_if<std::is_integral<T>::value, T>::type fromColumnValue(float value) {
+        double rounded = std::round(double(value));
+        if (!(rounded == rounded)) // NaN
+            return T();
+        if (rounded <= double(std::numeric_limits<T>::min()))
+            return std::numeric_limits<T>::min();
+        if (rounded >= double(std::numeric_limits<T>::max()))
+            return std::numeric_limits<T>::max();
+        return static_cast<T>(rounded);
+    }
+
+    /// Channel-major block of samples: one contiguous, 32-byte aligned column of floats per channel,
+    /// plus the receive timestamp of every sample. AD counts up to 24 bits are represented exactly,
+    /// wider integral formats and double are rounded to the 24-bit mantissa of float.
+    class RTColumns {
+    public:
+        RTColumns() = default;
+
+        RTColumns(size_t channels, size_t capacity) {
+            reset(channels, capacity);
+        }
+
+        RTColumns(const RTColumns &other) {
+            *this = other;
+        }
+
+        RTColumns &operator=(const RTColumns &other) {
+            if (this != &other) {
+                reset(other._channels, other._capacity);
+                resize(other._size);
+                for (size_t c = 0; c < _channels; c++) {
+                    std::memcpy(channel(c), other.channel(c), _size * sizeof(float));
+                }
+                std::copy(other._timestamps.begin(), other._timestamps.begin() + _size, _timestamps.begin());
+            }
+            return *this;
+        }
+
+        RTColumns(RTColumns &&other) {
+            *this = std::move(other);
+        }
+
+        RTColumns &operator=(RTColumns &&other) {
+            if (this != &other) {
+                _data = std::move(other._data);
+                _timestamps = std::move(other._timestamps);
+                _allocated = other._allocated;
+                _channels = other._channels;
+                _capacity = other._capacity;
+                _stride = other._stride;
+                _size = other._size;
+                other._timestamps.clear();
+                other._allocated = other._channels = other._capacity = other._stride = other._size = 0;
+            }
+            return *this;
+        }
+
+        /// Set the shape and drop all samples. Memory is only reallocated if it grows.
+        /// \param channels Number of channels
+        /// \param capacity Maximum number of samples
+        void reset(size_t channels, size_t capacity) {
+            size_t stride = (capacity * sizeof(float) + RT_COLUMN_ALIGNMENT - 1) / RT_COLUMN_ALIGNMENT
+                            * RT_COLUMN_ALIGNMENT / sizeof(float);
+            if (channels * stride > _allocated) {
+                _data.reset(static_cast<float *>(boost::alignment::aligned_alloc(
+                        RT_COLUMN_ALIGNMENT, std::max<size_t>(channels * stride, 1) * sizeof(float))));
+                if (!_data)
+                    throw std::bad_alloc();
+                _allocated = channels * stride;
+            }
+            _timestamps.resize(capacity);
+            _channels = channels;
+            _capacity = capacity;
+            _stride = stride;
+            _size = 0;
+        }
+
+        /// Set the number of samples without initializing new ones
+        /// \param size Number of samples, at most capacity()
+        void resize(size_t size) {
+            _size = std::min(size, _capacity);
+        }
+
+        void clear() {
+            _size = 0;
+        }
+
+        size_t channels() const { return _channels; }
+
+        size_t size() const { return _size; }
+
+        size_t capacity() const { return _capacity; }
+
+        bool empty() const { return _size == 0; }
+
+        /// Distance between two columns in floats, a multiple of 8
+        size_t stride() const { return _stride; }
+
+        float *channel(size_t c) { return _data.get() + c * _stride; }
+
+        const float *channel(size_t c) const { return _data.get() + c * _stride; }
+
+        uint64_t *timestamps() { return _timestamps.data(); }
+
+        const uint64_t *timestamps() const { return _timestamps.data(); }
+
+        float &operator()(size_t c, size_t i) { return channel(c)[i]; }
+
+        const float &operator()(size_t c, size_t i) const { return channel(c)[i]; }
+
+        /// Append samples of another block with the same number of channels
+        /// \param other The source block
+        /// \param begin Index of the first sample to copy
+        /// \param count Number of samples to copy, limited by the free capacity
+        /// \return      Number of samples copied
+        size_t append(const RTColumns &other, size_t begin, size_t count) {
+            count = std::min(count, _capacity - _size);
+            for (size_t c = 0; c < _channels; c++) {
+                std::memcpy(channel(c) + _size, other.channel(c) + begin, count * sizeof(float));
+            }
+            std::copy(other.timestamps() + begin, other.timestamps() + begin + count, timestamps() + _size);
+            _size += count;
+            return count;
+        }
+
+        /// Convert to the sample-major format used by the callback of startRealTimeDataRepeatedly.
+        /// Integral formats are rounded and clamped, see fromColumnValue. The values went through float,
+        /// so formats wider than its 24-bit mantissa keep only float precision, see decodePayload for exact values.
+        template<typename T>
+        void toRTData(std::vector<RTData<T>> &rtData) const {
+            rtData.resize(_size);
+            for (size_t i = 0; i < _size; i++) {
+                rtData[i].Timestamp = _timestamps[i];
+                rtData[i].Data.resize(_channels);
+                for (size_t c = 0; c < _channels; c++) {
+                    rtData[i].Data[c] = fromColumnValue<T>(channel(c)[i]);
+                }
+            }
+        }
+
+        /// Copy one sample into an RTSample, without Sequence
+        void toRTSample(size_t i, RTSample &sample) const {
+            sample.Timestamp = _timestamps[i];
+            sample.ChannelNumber = std::min(_channels, RT_MAX_CHANNELS);
+            for (size_t c = 0; c < sample.ChannelNumber; c++) {
+                sample.Data[c] = channel(c)[i];
+            }
+        }
+
+    private:
+        struct AlignedDeleter {
+            void operator()(float *p) const {
+                boost::alignment::aligned_free(p);
+            }
+        };
+
+        std::unique_ptr<float[], AlignedDeleter> _data;  // channel columns, each _stride floats apart
+        std::vector<uint64_t> _timestamps;               // receive time of every sample in ns
+        size_t _allocated = 0;                           // allocated floats
+        size_t _channels = 0;                            // number of channels
+        size_t _capacity = 0;                            // maximum number of samples
+        size_t _stride = 0;                              // floats between two columns
+        size_t _size = 0;                                // number of samples
+    }; // class RTColumns
+
+    /// Transpose the interleaved payload of a real time data frame into columns
+    /// \tparam T               The real time data format in the payload
+    /// \param[in] payload      The payload, nSamples samples of columns.channels() values each
+    /// \param[in] nSamples     Number of samples in the payload
+    /// \param[out] columns     The destination, its size grows by nSamples
+    /// \param[in] timestamp    The receive time assigned to all samples
+    /// \param[in] bias         Optional, subtracted from every channel while transposing
+    template<typename T>
+    void transposePayload(const int8_t *payload, size_t nSamples, RTColumns &columns, uint64_t timestamp,
+                          const float *bias = nullptr) {
+        size_t nChannel = columns.channels();
+        size_t offset = columns.size();
+        nSamples = std::min(nSamples, columns.capacity() - offset);
+        size_t i = 0;
+        if (nChannel > RT_MAX_CHANNELS)
+            bias = nullptr;
+        auto biasOf = [bias](size_t c) { return bias ? bias[c] : 0.0f; };
+
+#ifdef __SSE2__
+        if (std::is_same<T, float>::value) {
+            // 4 samples x 4 channels at a time, transposed in registers
+            const size_t rowBytes = nChannel * sizeof(float);
+            for (; i + 4 <= nSamples; i += 4) {
+                const int8_t *rows = payload + i * rowBytes;
+                size_t c = 0;
+                for (; c + 4 <= nChannel; c += 4) {
+                    __m128 r0 = _mm_loadu_ps(reinterpret_cast<const float *>(rows + c * sizeof(float)));
+                    __m128 r1 = _mm_loadu_ps(reinterpret_cast<const float *>(rows + rowBytes + c * sizeof(float)));
+                    __m128 r2 = _mm_loadu_ps(reinterpret_cast<const float *>(rows + 2 * rowBytes + c * sizeof(float)));
+                    __m128 r3 = _mm_loadu_ps(reinterpret_cast<const float *>(rows + 3 * rowBytes + c * sizeof(float)));
+                    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                    _mm_storeu_ps(columns.channel(c) + offset + i, _mm_sub_ps(r0, _mm_set1_ps(biasOf(c))));
+                    _mm_storeu_ps(columns.channel(c + 1) + offset + i, _mm_sub_ps(r1, _mm_set1_ps(biasOf(c + 1))));
+                    _mm_storeu_ps(columns.channel(c + 2) + offset + i, _mm_sub_ps(r2, _mm_set1_ps(biasOf(c + 2))));
+                    _mm_storeu_ps(columns.channel(c + 3) + offset + i, _mm_sub_ps(r3, _mm_set1_ps(biasOf(c + 3))));
+                }
+                for (; c < nChannel; c++) {
+                    float *dst = columns.channel(c) + offset + i;
+                    for (size_t k = 0; k < 4; k++) {
+                        std::memcpy(dst + k, rows + k * rowBytes + c * sizeof(float), sizeof(float));
+                        dst[k] -= biasOf(c);
+                    }
+                }
+            }
+        }
+#endif
+
+        for (; i < nSamples; i++) {
+            const int8_t *row = payload + i * nChannel * sizeof(T);
+            for (size_t c = 0; c < nChannel; c++) {
+                T val;
+                std::memcpy(&val, row + c * sizeof(T), sizeof(T));
+                columns.channel(c)[offset + i] = static_cast<float>(val) - biasOf(c);
+            }
+        }
+
+        std::fill(columns.timestamps() + offset, columns.timestamps() + offset + nSamples, timestamp);
+        columns.resize(offset + nSamples);
+    }
+
+    /// Decode the interleaved payload of a real time data frame directly into the sample-major format,
+    /// without the float columns, so every format keeps its full precision
+    /// \tparam T               The real time data format in the payload
+    /// \param[in] payload      The payload, nSamples samples of nChannel values each
+    /// \param[in] nSamples     Number of samples in the payload
+    /// \param[in] nChannel     Number of channels of every sample
+    /// \param[out] rtData      The decoded samples
+    /// \param[in] timestamp    The receive time assigned to all samples
+    /// \param[in] bias         Optional, subtracted from every channel, the result is rounded like fromColumnValue
+    template<typename T>
+    void decodePayload(const int8_t *payload, size_t nSamples, size_t nChannel, std::vector<RTData<T>> &rtData,
+                       uint64_t timestamp, const float *bias = nullptr) {
+        if (nChannel > RT_MAX_CHANNELS)
+            bias = nullptr;
+        rtData.resize(nSamples);
+        for (size_t i = 0; i < nSamples; i++) {
+            const int8_t *row = payload + i * nChannel * sizeof(T);
+            rtData[i].Timestamp = timestamp;
+            rtData[i].Data.resize(nChannel);
+            for (size_t c = 0; c < nChannel; c++) {
+                T val;
+                std::memcpy(&val, row + c * sizeof(T), sizeof(T));
+                rtData[i].Data[c] = bias ? fromColumnValue<T>(static_cast<float>(val) - bias[c]) : val;
+            }
+        }
+    }
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_RTCOLUMNS_HPP
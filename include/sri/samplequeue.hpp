@@ -0,0 +1,173 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_SAMPLEQUEUE_HPP
+#define SRI_FTSENSOR_SDK_SAMPLEQUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace SRI {
+    /// What happens when the consumer of a queue falls behind and the queue is full
+    enum class OverflowPolicy {
+        Block,         // The producer waits for free space. The sensor data backs up in the TCP window.
+        DropOldest,    // The oldest queued entry is dropped to make room.
+        DropNewest,    // The incoming entry is dropped.
+        ReplaceNewest  // The incoming entry replaces the newest queued one, whose samples are lost.
+    };
+
+    /// Counters of a SampleQueue, shared with the owner so they outlive the queue.
+    /// The queue does not reset them, the owner does once the threads of the previous queue are done.
+    struct QueueCounters {
+        std::atomic<uint64_t> Pushed{0};        // entries offered by the producer
+        std::atomic<uint64_t> Delivered{0};     // entries taken by the consumer
+        std::atomic<uint64_t> Dropped{0};       // entries lost by DropOldest or DropNewest
+        std::atomic<uint64_t> Replaced{0};      // entries replaced by ReplaceNewest
+        std::atomic<uint64_t> Blocked{0};       // pushes that had to wait by Block
+        std::atomic<size_t> Depth{0};           // entries currently queued
+        std::atomic<size_t> HighWatermark{0};   // maximum Depth seen
+
+        void reset() {
+            Pushed = 0;
+            Delivered = 0;
+            Dropped = 0;
+            Replaced = 0;
+            Blocked = 0;
+            Depth = 0;
+            HighWatermark = 0;
+        }
+    };
+
+    /// Snapshot of QueueCounters
+    struct QueueStatus {
+        OverflowPolicy Policy = OverflowPolicy::Block;
+        size_t Capacity = 0;        // 0 if no queue is used and the callback runs in the receiving thread
+        uint64_t Pushed = 0;
+        uint64_t Delivered = 0;
+        uint64_t Dropped = 0;
+        uint64_t Replaced = 0;
+        uint64_t Blocked = 0;
+        size_t Depth = 0;
+        size_t HighWatermark = 0;
+    };
+
+    /// Bounded single-producer single-consumer queue with an explicit overflow policy
+    /// \tparam E The entry type, moved in and out
+    template<typename E>
+    class SampleQueue {
+    public:
+        SampleQueue(OverflowPolicy policy, size_t capacity, std::shared_ptr<QueueCounters> counters)
+                : _policy(policy), _capacity(capacity > 0 ? capacity : 1), _counters(counters), _entries(_capacity) {}
+
+        /// Offer an entry, applying the overflow policy if the queue is full. The entry is swapped in,
+        /// so it comes back with storage to reuse: the dropped or replaced entry if one was lost,
+        /// the incoming entry itself for DropNewest, otherwise whatever pop() left in the slot.
+        /// \return false if the queue was closed
+        bool push(E &entry) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_closed)
+                return false;
+
+            _counters->Pushed++;
+            if (_size >= _capacity) {
+                switch (_policy) {
+                    case OverflowPolicy::Block:
+                        _counters->Blocked++;
+                        _notFull.wait(lock, [this] { return _size < _capacity || _closed; });
+                        if (_closed)
+                            return false;
+                        break;
+                    case OverflowPolicy::DropOldest:
+                        // the newest takes the slot of the oldest
+                        std::swap(_entries[_head], entry);
+                        _head = (_head + 1) % _capacity;
+                        _counters->Dropped++;
+                        return true;
+                    case OverflowPolicy::DropNewest:
+                        _counters->Dropped++;
+                        return true;
+                    case OverflowPolicy::ReplaceNewest:
+                        std::swap(_entries[(_head + _size - 1) % _capacity], entry);
+                        _counters->Replaced++;
+                        return true;
+                }
+            }
+
+            std::swap(_entries[(_head + _size) % _capacity], entry);
+            _size++;
+            updateDepth();
+            lock.unlock();
+            _notEmpty.notify_one();
+            return true;
+        }
+
+        /// Take the next entry, waiting until one is available
+        /// \param[out] entry The entry
+        /// \return           false if the queue is closed and drained
+        bool pop(E &entry) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _notEmpty.wait(lock, [this] { return _size > 0 || _closed; });
+            if (_size == 0)
+                return false;
+
+            entry = std::move(_entries[_head]);
+            _head = (_head + 1) % _capacity;
+            _size--;
+            _counters->Delivered++;
+            updateDepth();
+            lock.unlock();
+            _notFull.notify_one();
+            return true;
+        }
+
+        /// Refuse new entries and wake up both sides. Queued entries can still be popped.
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _closed = true;
+            }
+            _notEmpty.notify_all();
+            _notFull.notify_all();
+        }
+
+    private:
+        void updateDepth() {
+            size_t depth = _size;
+            _counters->Depth = depth;
+            if (depth > _counters->HighWatermark)
+                _counters->HighWatermark = depth;
+        }
+
+        OverflowPolicy _policy;                     // applied when the queue is full
+        size_t _capacity;                           // maximum number of queued entries
+        std::shared_ptr<QueueCounters> _counters;   // statistics, readable from any thread
+        std::vector<E> _entries;                    // ring of queued entries, allocated once
+        size_t _head = 0;                           // index of the oldest entry
+        size_t _size = 0;                           // number of queued entries
+        bool _closed = false;                       // set by close()
+        std::mutex _mutex;
+        std::condition_variable _notEmpty;
+        std::condition_variable _notFull;
+    }; // class SampleQueue
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_SAMPLEQUEUE_HPP
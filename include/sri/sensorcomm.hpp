@@ -24,12 +24,25 @@ Shenyang Institute of Automation, Chinese Academy of Sciences.
 #ifndef SRI_FTSENSOR_SDK_SENSORCOMM_HPP
 #define SRI_FTSENSOR_SDK_SENSORCOMM_HPP
 
+#include <sri/bufferpool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
+#include <boost/function.hpp>
 
 namespace SRI {
     class SensorComm {
     public:
+        /// Called with false and an empty buffer if the command could not be sent or timed out
+        typedef boost::function<void(bool, const FrameBuffer&)> ResponseHandler;
+
         SensorComm() = default;
 
         virtual ~SensorComm() = 0; // Pure virtual deconstructor for polymorphism
@@ -40,6 +53,11 @@ namespace SRI {
 
         virtual bool initialize() = 0;// Initialize the communication
 
+        /// Replace a lost connection, transports with a faster way than initialize() override it
+        virtual bool reconnect() {
+            return initialize();
+        }
+
 
         /// Write Data Buffer to Sensor
         /// \param buf The data need to send
@@ -55,14 +73,111 @@ namespace SRI {
         virtual size_t read(std::string& buf) = 0;
         virtual size_t read(char* buf, size_t n) = 0;
 
+        /// Append the available data to a buffer, reading into its capacity without value-initialization
+        /// \param[in,out] buf The buffer, grown only if its capacity is too small
+        /// \return            The number of chars have been received
+        virtual size_t read(FrameBuffer &buf) {
+            size_t size = buf.size();
+            buf.resize(size + available());
+            size_t n = read(reinterpret_cast<char *>(buf.data()) + size, buf.size() - size);
+            buf.resize(size + n);
+            return n;
+        }
+
         virtual size_t available() = 0;
 
+        /// Receive time of the data returned by the last read, for transports timestamping in the kernel
+        /// \return The steady clock time in ns, 0 if the transport does not know it
+        virtual uint64_t getReceiveTimestamp() {
+            return 0;
+        }
+
+        /// Send a command and receive its response without blocking the caller. Transactions are
+        /// carried out one after another in the order of the calls. Not to be mixed with blocking
+        /// calls or real time data while in flight. The default implementation uses the blocking
+        /// calls on a helper thread owned by the transport, transports with an event loop override it.
+        /// \param command     The command buffer, e.g. AT+SMPR=?\r\n
+        /// \param timeoutMs   Maximum time to wait for the response
+        /// \param handler     Called with the received response, from another thread
+        virtual void asyncTransact(const std::string &command, uint32_t timeoutMs, ResponseHandler handler) {
+            std::lock_guard<std::mutex> lock(_transactMutex);
+            if (_transactStopping) {
+                handler(false, FrameBuffer());
+                return;
+            }
+            _transactions.push_back(Transaction{command, timeoutMs, handler});
+            if (!_transactThread.joinable())
+                _transactThread = std::thread(&SensorComm::transactionWorker, this);
+            _transactWake.notify_one();
+        }
+
     protected:
-        bool _validStatus = false;     // The status of the communication with the sensor
+        /// End the helper thread of the default asyncTransact after the running transaction, the queued
+        /// ones fail. Transports relying on it call this first in their destructor, as the helper thread
+        /// uses their read and write.
+        void stopTransactions() {
+            {
+                std::lock_guard<std::mutex> lock(_transactMutex);
+                _transactStopping = true;
+            }
+            _transactWake.notify_one();
+            if (_transactThread.joinable())
+                _transactThread.join();
+        }
+
+        std::atomic<bool> _validStatus{false}; // The status of the communication with the sensor, read by
+                                               // the receiving, transaction and standby threads
+
+    private:
+        struct Transaction {
+            std::string Command;
+            uint32_t Timeout;          // in ms
+            ResponseHandler Handler;
+        };
+
+        void transactionWorker() {
+            std::unique_lock<std::mutex> lock(_transactMutex);
+            for (;;) {
+                _transactWake.wait(lock, [this]() { return _transactStopping || !_transactions.empty(); });
+                if (_transactStopping)
+                    break;
+                Transaction transaction = std::move(_transactions.front());
+                _transactions.pop_front();
+                lock.unlock();
+
+                FrameBuffer response;
+                bool ok = isValid();
+                if (ok && available() > 0)
+                    read(response); // late response of a timed out transaction, it must not answer this one
+                response.clear();
+                ok = ok && write(transaction.Command) == transaction.Command.size();
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(transaction.Timeout);
+                while (ok && available() == 0 && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(500));
+                }
+                ok = ok && read(response) > 0;
+                transaction.Handler(ok, response);
+
+                lock.lock();
+            }
+            std::deque<Transaction> failed;
+            failed.swap(_transactions);
+            lock.unlock();
+            for (Transaction &transaction : failed)
+                transaction.Handler(false, FrameBuffer());
+        }
+
+        std::mutex _transactMutex;     // guards the queue of the default asyncTransact
+        std::condition_variable _transactWake;  // wakes the helper thread
+        std::deque<Transaction> _transactions;  // queued transactions of the default asyncTransact
+        std::thread _transactThread;   // helper thread of the default asyncTransact, started by the first call
+        bool _transactStopping = false;   // stopTransactions() was called
 
     }; // class SensorComm
 
-    SensorComm::~SensorComm() {}
+    inline SensorComm::~SensorComm() {
+        stopTransactions(); // only a fallback, the transport is already destroyed at this point
+    }
 } //namespace SRI
 
 
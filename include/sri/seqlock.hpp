@@ -0,0 +1,114 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_SEQLOCK_HPP
+#define SRI_FTSENSOR_SDK_SEQLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace SRI {
+    /// Single-writer sequence lock for small trivially copyable values.
+    /// The writer never waits. Readers copy the value without locking and retry
+    /// if a write was in progress, so a read costs a few atomic loads.
+    /// The payload is kept in atomic words to avoid data races on the copy.
+    /// The size is padded to whole cache lines rather than the type being over-aligned,
+    /// so it can be created with plain new under C++11.
+    template<typename T>
+    class SeqLock {
+        static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+    public:
+        SeqLock() : _seq(0) {
+            T value = T();
+            uint64_t words[WORDS] = {};
+            std::memcpy(words, &value, sizeof(T));
+            for (size_t i = 0; i < WORDS; i++) {
+                _data[i].store(words[i], std::memory_order_relaxed);
+            }
+        }
+
+        SeqLock(const SeqLock &) = delete;
+        SeqLock &operator=(const SeqLock &) = delete;
+
+        /// Publish a new value. Must only be called from one thread at a time.
+        /// \param value The value to publish
+        void store(const T &value) {
+            uint64_t words[WORDS] = {};
+            std::memcpy(words, &value, sizeof(T));
+
+            uint64_t seq = _seq.load(std::memory_order_relaxed);
+            _seq.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; i++) {
+                _data[i].store(words[i], std::memory_order_relaxed);
+            }
+            _seq.store(seq + 2, std::memory_order_release);
+        }
+
+        /// Try to copy the current value once.
+        /// \param[out] value The consistent copy, untouched on failure
+        /// \return           false if a write overlapped the read
+        bool tryLoad(T &value) const {
+            uint64_t seq0 = _seq.load(std::memory_order_acquire);
+            if (seq0 & 1) {
+                return false;
+            }
+
+            uint64_t words[WORDS];
+            for (size_t i = 0; i < WORDS; i++) {
+                words[i] = _data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (_seq.load(std::memory_order_relaxed) != seq0) {
+                return false;
+            }
+
+            std::memcpy(&value, words, sizeof(T));
+            return true;
+        }
+
+        /// Copy the current value, retrying until no write overlaps.
+        T load() const {
+            T value;
+            while (!tryLoad(value)) {
+                std::this_thread::yield();
+            }
+            return value;
+        }
+
+        /// Number of completed stores.
+        uint64_t version() const {
+            return _seq.load(std::memory_order_acquire) / 2;
+        }
+
+    private:
+        static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        static const size_t LINE_WORDS = 64 / sizeof(uint64_t);
+        static const size_t PADDED_WORDS = (WORDS + 1 + LINE_WORDS - 1) / LINE_WORDS * LINE_WORDS - 1;
+
+        std::atomic<uint64_t> _seq;               // even: stable, odd: write in progress
+        std::atomic<uint64_t> _data[PADDED_WORDS]; // payload split into words, the rest pads to the cache line
+    }; // class SeqLock
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_SEQLOCK_HPP
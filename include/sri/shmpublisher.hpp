@@ -0,0 +1,390 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_SHMPUBLISHER_HPP
+#define SRI_FTSENSOR_SDK_SHMPUBLISHER_HPP
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SRI_FTSENSOR_SDK_HAS_SHM 1
+
+#include <sri/types.hpp>
+#include <sri/seqlock.hpp>
+#include <sri/logger.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <string>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace SRI {
+    const uint32_t SHM_MAGIC = 0x46495253;  // "SRIF"
+    const uint32_t SHM_VERSION = 2;
+    const size_t SHM_MAX_WEIGHTS = 16;      // filter weights kept in the header
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory ring needs address-free 64 bit atomics");
+
+    /// RTDataMode in a fixed layout that can be shared between processes
+    struct ShmModeInfo {
+        uint16_t ChannelNumber = 0;
+        uint16_t ChannelOrder[RT_MAX_CHANNELS] = {};
+        char DataUnit = 'C';
+        uint16_t PNpCH = 1;
+        char FM[8] = {};
+        uint16_t WeightNumber = 0;
+        uint16_t FilterWeights[SHM_MAX_WEIGHTS] = {};
+    };
+
+    /// Header at the start of the shared memory object, followed by Capacity slots
+    struct ShmHeader {
+        std::atomic<uint32_t> Magic;    // set last by the publisher, readers wait for it, cleared on close
+        uint32_t Version;
+        uint32_t Capacity;              // number of slots, power of two
+        uint32_t SlotSize;              // sizeof(ShmSlot), checked by readers
+        uint64_t Generation;            // non-zero, differs for every object a publisher creates
+        alignas(64) SeqLock<ShmModeInfo> Mode; // the RTDataMode of the published stream
+        alignas(64) std::atomic<uint64_t> Head; // sequence of the newest published slot
+    };
+
+    struct ShmEntry {
+        uint64_t Sequence = 0; // 0 means never written
+        RTSample Sample;
+    };
+
+    typedef SeqLock<ShmEntry> ShmSlot;
+
+    inline size_t getShmSize(size_t capacity) {
+        return sizeof(ShmHeader) + capacity * sizeof(ShmSlot);
+    }
+
+    inline ShmSlot *getShmSlots(ShmHeader *header) {
+        return reinterpret_cast<ShmSlot *>(reinterpret_cast<char *>(header) + sizeof(ShmHeader));
+    }
+
+    /// Publishes decoded samples into a POSIX shared memory ring.
+    /// The publisher never waits for readers, a reader that falls a whole ring behind skips samples.
+    class ShmPublisher {
+    public:
+        ShmPublisher() = default;
+
+        ~ShmPublisher() {
+            close();
+        }
+
+        ShmPublisher(const ShmPublisher &) = delete;
+        ShmPublisher &operator=(const ShmPublisher &) = delete;
+
+        /// Create the shared memory object. An existing object is never reused: it may belong to another
+        /// publisher, and initializing it would wipe the ring under its readers.
+        /// \param name         The object name, e.g. "/sri_ftsensor"
+        /// \param capacity     Number of samples kept, rounded up to a power of two
+        /// \param permissions  Access of the object, 0600 for the own user, 0660 to add the group
+        /// \param replace      Remove an existing object first, e.g. one left behind by a crashed publisher.
+        ///                     Readers still attached to it keep the old mapping and see it closed.
+        /// \return             false if the object exists and replace is false, or on errors
+        bool open(const std::string &name, size_t capacity = 1024, mode_t permissions = 0600, bool replace = false) {
+            close();
+
+            size_t cap = 1;
+            while (cap < capacity) {
+                cap <<= 1;
+            }
+
+            if (replace && shm_unlink(name.c_str()) != 0 && errno != ENOENT) {
+                SRI_LOG(Error, "SRI::SHM::Error removing shared memory %s: %s", name.c_str(), std::strerror(errno));
+                return false;
+            }
+
+            int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, permissions);
+            if (fd < 0) {
+                if (errno == EEXIST)
+                    SRI_LOG(Error, "SRI::SHM::Shared memory %s exists already, another publisher may use it", name.c_str());
+                else
+                    SRI_LOG(Error, "SRI::SHM::Error creating shared memory %s: %s", name.c_str(), std::strerror(errno));
+                return false;
+            }
+            fchmod(fd, permissions); // not narrowed by the umask
+            struct stat st;
+            fstat(fd, &st);
+
+            size_t size = getShmSize(cap);
+            if (ftruncate(fd, size) != 0) {
+                SRI_LOG(Error, "SRI::SHM::Error resizing shared memory %s: %s", name.c_str(), std::strerror(errno));
+                ::close(fd);
+                shm_unlink(name.c_str());
+                return false;
+            }
+
+            void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (addr == MAP_FAILED) {
+                SRI_LOG(Error, "SRI::SHM::Error mapping shared memory %s: %s", name.c_str(), std::strerror(errno));
+                shm_unlink(name.c_str());
+                return false;
+            }
+
+            _header = static_cast<ShmHeader *>(addr);
+            _header->Magic.store(0, std::memory_order_relaxed);
+            _header->Version = SHM_VERSION;
+            _header->Capacity = cap;
+            _header->SlotSize = sizeof(ShmSlot);
+            _header->Generation = uint64_t(std::chrono::system_clock::now().time_since_epoch().count()) | 1;
+            new(&_header->Mode) SeqLock<ShmModeInfo>();
+            new(&_header->Head) std::atomic<uint64_t>(0);
+            _slots = getShmSlots(_header);
+            for (size_t i = 0; i < cap; i++) {
+                new(&_slots[i]) ShmSlot();
+            }
+            _header->Magic.store(SHM_MAGIC, std::memory_order_release);
+
+            _name = name;
+            _device = st.st_dev;
+            _inode = st.st_ino;
+            _size = size;
+            _head = 0;
+            return true;
+        }
+
+        /// Unmap and remove the shared memory object. Attached readers keep their mapping and see it closed.
+        void close() {
+            if (_header == nullptr)
+                return;
+
+            _header->Magic.store(0, std::memory_order_release);
+            munmap(_header, _size);
+            if (isOwnObject())
+                shm_unlink(_name.c_str());
+            _header = nullptr;
+            _slots = nullptr;
+        }
+
+        bool isValid() const {
+            return _header != nullptr;
+        }
+
+        /// Describe the published stream to readers
+        void setRealTimeDataMode(const RTDataMode &rtMode) {
+            if (!isValid())
+                return;
+
+            ShmModeInfo info;
+            info.ChannelNumber = std::min(rtMode.channelOrder.size(), RT_MAX_CHANNELS);
+            std::copy(rtMode.channelOrder.begin(), rtMode.channelOrder.begin() + info.ChannelNumber, info.ChannelOrder);
+            info.DataUnit = rtMode.DataUnit;
+            info.PNpCH = rtMode.PNpCH;
+            std::strncpy(info.FM, rtMode.FM.c_str(), sizeof(info.FM) - 1);
+            info.WeightNumber = std::min(rtMode.filterWeights.size(), SHM_MAX_WEIGHTS);
+            std::copy(rtMode.filterWeights.begin(), rtMode.filterWeights.begin() + info.WeightNumber, info.FilterWeights);
+
+            _header->Mode.store(info);
+        }
+
+        /// Publish one sample. Must only be called from one thread.
+        void publish(const RTSample &sample) {
+            if (!isValid())
+                return;
+
+            ShmEntry entry;
+            entry.Sequence = ++_head;
+            entry.Sample = sample;
+            _slots[_head & (_header->Capacity - 1)].store(entry);
+            _header->Head.store(_head, std::memory_order_release);
+        }
+
+    private:
+        /// Check that the name still refers to the created object, not to the one of a replacing publisher
+        bool isOwnObject() const {
+            int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            bool own = fstat(fd, &st) == 0 && st.st_dev == _device && st.st_ino == _inode;
+            ::close(fd);
+            return own;
+        }
+
+        std::string _name;              // shared memory object name
+        dev_t _device = 0;              // device and inode of the created object
+        ino_t _inode = 0;
+        size_t _size = 0;               // mapped size in bytes
+        ShmHeader *_header = nullptr;   // mapped header
+        ShmSlot *_slots = nullptr;      // mapped slots after the header
+        uint64_t _head = 0;             // sequence of the newest published slot
+    }; // class ShmPublisher
+
+    /// Reads the samples of a ShmPublisher from another process
+    class ShmReader {
+    public:
+        ShmReader() = default;
+
+        ~ShmReader() {
+            close();
+        }
+
+        ShmReader(const ShmReader &) = delete;
+        ShmReader &operator=(const ShmReader &) = delete;
+
+        /// Attach to a shared memory object. Reading starts with the next published sample.
+        /// \param name The object name given to ShmPublisher::open()
+        /// \return     true if attached
+        bool open(const std::string &name) {
+            close();
+
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0) {
+                SRI_LOG(Error, "SRI::SHM::Error opening shared memory %s: %s", name.c_str(), std::strerror(errno));
+                return false;
+            }
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ShmHeader)) {
+                SRI_LOG(Error, "SRI::SHM::Error shared memory %s is not initialized", name.c_str());
+                ::close(fd);
+                return false;
+            }
+
+            void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (addr == MAP_FAILED) {
+                SRI_LOG(Error, "SRI::SHM::Error mapping shared memory %s: %s", name.c_str(), std::strerror(errno));
+                return false;
+            }
+
+            _header = static_cast<const ShmHeader *>(addr);
+            _size = st.st_size;
+            // the magic is stored last, only then the rest of the header is complete
+            if (_header->Magic.load(std::memory_order_acquire) != SHM_MAGIC ||
+                _header->Version != SHM_VERSION ||
+                _header->Generation == 0 ||
+                _header->SlotSize != sizeof(ShmSlot) ||
+                _header->Capacity == 0 || (_header->Capacity & (_header->Capacity - 1)) != 0 ||
+                getShmSize(_header->Capacity) > _size) {
+                SRI_LOG(Error, "SRI::SHM::Error shared memory %s has an incompatible layout", name.c_str());
+                close();
+                return false;
+            }
+
+            _generation = _header->Generation;
+            _slots = getShmSlots(const_cast<ShmHeader *>(_header));
+            _cursor = _header->Head.load(std::memory_order_acquire) + 1;
+            _lost = 0;
+            return true;
+        }
+
+        void close() {
+            if (_header == nullptr)
+                return;
+
+            munmap(const_cast<ShmHeader *>(_header), _size);
+            _header = nullptr;
+            _slots = nullptr;
+        }
+
+        bool isValid() const {
+            return _header != nullptr;
+        }
+
+        /// Check whether the publisher still writes into the attached object. After false, close()
+        /// and open() again to attach to the object of a restarted publisher.
+        bool isPublishing() const {
+            return isValid() && _header->Magic.load(std::memory_order_acquire) == SHM_MAGIC &&
+                   _header->Generation == _generation;
+        }
+
+        /// Get the RTDataMode of the published stream
+        RTDataMode getRealTimeDataMode() const {
+            RTDataMode rtMode;
+            if (!isValid())
+                return rtMode;
+
+            ShmModeInfo info = _header->Mode.load();
+            rtMode.channelOrder.assign(info.ChannelOrder, info.ChannelOrder + info.ChannelNumber);
+            rtMode.DataUnit = info.DataUnit;
+            rtMode.PNpCH = info.PNpCH;
+            rtMode.FM = std::string(info.FM, strnlen(info.FM, sizeof(info.FM)));
+            rtMode.filterWeights.assign(info.FilterWeights, info.FilterWeights + info.WeightNumber);
+            return rtMode;
+        }
+
+        /// Take the next sample
+        /// \param[out] sample The sample
+        /// \return            false if there is no new sample
+        bool poll(RTSample &sample) {
+            if (!isValid())
+                return false;
+
+            uint64_t capacity = _header->Capacity;
+            for (;;) {
+                ShmEntry entry;
+                if (!_slots[_cursor & (capacity - 1)].tryLoad(entry)) {
+                    return false; // slot is just being written
+                }
+                if (entry.Sequence < _cursor) {
+                    return false; // not published yet
+                }
+                if (entry.Sequence > _cursor) { // lapped by the publisher
+                    uint64_t head = _header->Head.load(std::memory_order_acquire);
+                    uint64_t oldest = head >= capacity ? head - capacity + 2 : 1;
+                    oldest = std::max(oldest, _cursor + 1);
+                    _lost += oldest - _cursor;
+                    _cursor = oldest;
+                    continue;
+                }
+
+                sample = entry.Sample;
+                _cursor++;
+                return true;
+            }
+        }
+
+        /// Get the newest published sample, its Sequence is 0 if nothing was published yet
+        RTSample getLatest() const {
+            if (!isValid())
+                return RTSample();
+
+            uint64_t head = _header->Head.load(std::memory_order_acquire);
+            ShmEntry entry;
+            if (head == 0 || !_slots[head & (_header->Capacity - 1)].tryLoad(entry) || entry.Sequence < head)
+                return RTSample();
+            return entry.Sample;
+        }
+
+        /// Number of samples skipped because the reader was lapped
+        uint64_t lost() const {
+            return _lost;
+        }
+
+    private:
+        size_t _size = 0;                       // mapped size in bytes
+        const ShmHeader *_header = nullptr;     // mapped header
+        const ShmSlot *_slots = nullptr;        // mapped slots after the header
+        uint64_t _cursor = 0;                   // sequence of the next sample to take
+        uint64_t _lost = 0;                     // samples skipped after being lapped
+        uint64_t _generation = 0;               // Generation of the object at open()
+    }; // class ShmReader
+} //namespace SRI
+
+#endif // defined(__unix__) || defined(__APPLE__)
+
+#endif //SRI_FTSENSOR_SDK_SHMPUBLISHER_HPP
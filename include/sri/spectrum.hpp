@@ -0,0 +1,288 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_SPECTRUM_HPP
+#define SRI_FTSENSOR_SDK_SPECTRUM_HPP
+
+#include <sri/types.hpp>
+#include <sri/broadcastring.hpp>
+#include <sri/filter.hpp> // RT_PI
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/function.hpp>
+
+namespace SRI {
+    /// Radix-2 FFT with twiddle factors and bit-reversal table computed once
+    class FFTPlan {
+    public:
+        /// \param n Transform size, rounded up to a power of two of at least 2, see size()
+        explicit FFTPlan(size_t n = 256) : _n(roundUp(n)), _twiddles(_n / 2), _reversed(_n) {
+            n = _n;
+            for (size_t k = 0; k < n / 2; k++) {
+                _twiddles[k] = std::polar(1.0, -2.0 * RT_PI * k / n);
+            }
+            size_t bits = 0;
+            while ((size_t(1) << bits) < n) {
+                bits++;
+            }
+            for (size_t i = 0; i < n; i++) {
+                size_t r = 0;
+                for (size_t b = 0; b < bits; b++) {
+                    r |= ((i >> b) & 1) << (bits - 1 - b);
+                }
+                _reversed[i] = r;
+            }
+        }
+
+        size_t size() const {
+            return _n;
+        }
+
+        /// The transform size used for n
+        static size_t roundUp(size_t n) {
+            size_t size = 2;
+            while (size < n) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        /// In-place forward transform of size() values
+        void forward(std::complex<double> *data) const {
+            for (size_t i = 0; i < _n; i++) {
+                if (i < _reversed[i])
+                    std::swap(data[i], data[_reversed[i]]);
+            }
+            for (size_t len = 2; len <= _n; len <<= 1) {
+                size_t step = _n / len;
+                for (size_t i = 0; i < _n; i += len) {
+                    for (size_t k = 0; k < len / 2; k++) {
+                        std::complex<double> t = _twiddles[k * step] * data[i + k + len / 2];
+                        data[i + k + len / 2] = data[i + k] - t;
+                        data[i + k] += t;
+                    }
+                }
+            }
+        }
+
+    private:
+        size_t _n;                                      // transform size
+        std::vector<std::complex<double>> _twiddles;    // exp(-2 pi i k / n)
+        std::vector<size_t> _reversed;                  // bit-reversed indices
+    }; // class FFTPlan
+
+    enum class WindowType {
+        Rectangular,
+        Hann,
+        Hamming,
+        Blackman
+    };
+
+    struct SpectrumConfig {
+        size_t FFTSize = 256;           // samples per segment, at least 2. Other sizes than a power of two are
+                                        // zero-padded to the next one, which then sets the bins and Resolution
+        size_t Hop = 128;               // new samples between two segments, FFTSize / 2 for 50% overlap
+        WindowType Window = WindowType::Hann;
+        double SampleRate = 1000;       // rate of the analysed stream in Hz, SMPR divided by any decimation
+        size_t Averages = 8;            // segments averaged into the Welch PSD
+        std::vector<std::pair<double, double>> Bands; // frequency bands [low, high) in Hz for BandEnergy
+    };
+
+    struct SpectrumResult {
+        uint64_t Timestamp = 0;                         // receive time of the newest sample in the last segment
+        double Resolution = 0;                          // Hz per bin
+        std::vector<std::vector<double>> Psd;           // one-sided PSD per channel, FFTSize / 2 + 1 bins, unit^2/Hz
+        std::vector<std::vector<double>> BandEnergy;    // PSD integrated over each configured band, per channel
+    };
+
+    /// Welch power spectral density of every channel over overlapped, windowed segments.
+    /// Feed it with process() or let start() run it on a worker thread that polls a ring subscriber,
+    /// so the receiving thread never waits for the FFTs.
+    class RTSpectrum {
+    public:
+        typedef boost::function<void(const SpectrumResult&)> ResultHandler;
+
+        explicit RTSpectrum(const SpectrumConfig &config = SpectrumConfig())
+                : _config(config), _plan(config.FFTSize) {
+            _config.FFTSize = std::max<size_t>(config.FFTSize, 2);
+            size_t n = _config.FFTSize;
+            size_t m = _plan.size();
+            _window.resize(n);
+            double power = 0;
+            for (size_t i = 0; i < n; i++) {
+                double x = double(i) / n; // periodic windows
+                switch (config.Window) {
+                    case WindowType::Hann: _window[i] = 0.5 - 0.5 * std::cos(2 * RT_PI * x); break;
+                    case WindowType::Hamming: _window[i] = 0.54 - 0.46 * std::cos(2 * RT_PI * x); break;
+                    case WindowType::Blackman:
+                        _window[i] = 0.42 - 0.5 * std::cos(2 * RT_PI * x) + 0.08 * std::cos(4 * RT_PI * x);
+                        break;
+                    default: _window[i] = 1.0; break;
+                }
+                power += _window[i] * _window[i];
+            }
+            _scale = 1.0 / (config.SampleRate * power);
+            _config.Hop = std::max<size_t>(std::min(config.Hop, n), 1);
+            _config.Averages = std::max<size_t>(config.Averages, 1);
+
+            size_t bins = m / 2 + 1;
+            _input.assign(RT_MAX_CHANNELS * n, 0.0);
+            _segments.assign(RT_MAX_CHANNELS * _config.Averages * bins, 0.0);
+            _sum.assign(RT_MAX_CHANNELS * bins, 0.0);
+            _buffer.resize(m);
+            _result.Resolution = config.SampleRate / m;
+        }
+
+        ~RTSpectrum() {
+            stop();
+        }
+
+        RTSpectrum(const RTSpectrum &) = delete;
+        RTSpectrum &operator=(const RTSpectrum &) = delete;
+
+        /// Called on the analysing thread with every new result
+        void setHandler(ResultHandler handler) {
+            _handler = handler;
+        }
+
+        /// Start a worker thread that takes samples from a subscriber, e.g. FTSensor::subscribeRealTimeData()
+        void start(BroadcastRing<RTSample>::SubscriberPtr subscriber) {
+            stop();
+            _running = true;
+            _thread = std::thread([this, subscriber]() {
+                RTSample sample;
+                while (_running) {
+                    if (subscriber->poll(sample)) {
+                        process(sample);
+                    } else {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                }
+            });
+        }
+
+        void stop() {
+            _running = false;
+            if (_thread.joinable())
+                _thread.join();
+        }
+
+        /// Add one sample, computes a new segment every Hop samples
+        void process(const RTSample &sample) {
+            size_t n = _config.FFTSize;
+            _channels = std::min<size_t>(sample.ChannelNumber, RT_MAX_CHANNELS);
+            for (size_t c = 0; c < _channels; c++) {
+                _input[c * n + _pos] = sample.Data[c];
+            }
+            _pos = (_pos + 1) % n;
+            _filled = std::min(_filled + 1, n);
+            _lastTimestamp = sample.Timestamp;
+
+            if (_filled == n && ++_sinceLast >= _config.Hop) {
+                _sinceLast = 0;
+                analyse();
+            }
+        }
+
+        /// Get the latest result, safe from any thread
+        SpectrumResult getResult() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _result;
+        }
+
+    private:
+        void analyse() {
+            size_t n = _config.FFTSize;
+            size_t m = _plan.size();
+            size_t bins = m / 2 + 1;
+            size_t slot = _segmentCount % _config.Averages;
+            size_t averaged = std::min(_segmentCount + 1, _config.Averages);
+
+            SpectrumResult result;
+            result.Timestamp = _lastTimestamp;
+            result.Resolution = _config.SampleRate / m;
+            result.Psd.resize(_channels);
+            result.BandEnergy.resize(_channels);
+            for (size_t c = 0; c < _channels; c++) {
+                // oldest sample first, the input is a ring starting at _pos
+                for (size_t i = 0; i < n; i++) {
+                    _buffer[i] = std::complex<double>(_input[c * n + (_pos + i) % n] * _window[i], 0.0);
+                }
+                std::fill(_buffer.begin() + n, _buffer.end(), std::complex<double>()); // zero-padding
+                _plan.forward(_buffer.data());
+
+                double *segment = &_segments[(c * _config.Averages + slot) * bins];
+                double *sum = &_sum[c * bins];
+                result.Psd[c].resize(bins);
+                for (size_t k = 0; k < bins; k++) {
+                    double p = std::norm(_buffer[k]) * _scale * ((k == 0 || k == m / 2) ? 1.0 : 2.0);
+                    sum[k] += p - segment[k];
+                    segment[k] = p;
+                    result.Psd[c][k] = sum[k] / averaged;
+                }
+
+                for (auto &band : _config.Bands) {
+                    double energy = 0;
+                    for (size_t k = 0; k < bins; k++) {
+                        double f = k * result.Resolution;
+                        if (f >= band.first && f < band.second)
+                            energy += result.Psd[c][k] * result.Resolution;
+                    }
+                    result.BandEnergy[c].push_back(energy);
+                }
+            }
+            _segmentCount++;
+
+            if (_handler)
+                _handler(result);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _result = std::move(result);
+        }
+
+        SpectrumConfig _config;
+        FFTPlan _plan;                                  // planned once for FFTSize rounded up to a power of two
+        std::vector<double> _window;                    // window function
+        double _scale = 1;                              // PSD normalization 1 / (fs * sum(w^2))
+        std::vector<double> _input;                     // last FFTSize samples per channel, ring
+        std::vector<double> _segments;                  // last Averages periodograms per channel
+        std::vector<double> _sum;                       // sum of the stored periodograms per channel
+        std::vector<std::complex<double>> _buffer;      // FFT work buffer
+        size_t _channels = 0;                           // channels of the stream
+        size_t _pos = 0;                                // next write position in _input
+        size_t _filled = 0;                             // valid samples in _input
+        size_t _sinceLast = 0;                          // samples since the last segment
+        size_t _segmentCount = 0;                       // segments analysed
+        uint64_t _lastTimestamp = 0;                    // timestamp of the newest sample
+        ResultHandler _handler;                         // optional result callback
+        SpectrumResult _result;                         // latest result, guarded by _mutex
+        mutable std::mutex _mutex;
+        std::atomic<bool> _running{false};              // worker thread runs
+        std::thread _thread;                            // optional worker thread
+    }; // class RTSpectrum
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_SPECTRUM_HPP
@@ -0,0 +1,214 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_STATISTICS_HPP
+#define SRI_FTSENSOR_SDK_STATISTICS_HPP
+
+#include <sri/types.hpp>
+#include <sri/rtcolumns.hpp>
+#include <sri/seqlock.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+namespace SRI {
+    /// Statistics of one channel
+    struct ChannelStatistics {
+        uint64_t Count = 0;     // number of samples
+        double Mean = 0;
+        double Variance = 0;    // population variance
+        double Min = 0;
+        double Max = 0;
+        double Rms = 0;         // root mean square
+    };
+
+    /// Statistics of all channels, since start (Cumulative) and over the last WindowSize samples (Window)
+    struct RTStatistics {
+        uint64_t Timestamp = 0;         // receive time of the newest sample included
+        uint16_t ChannelNumber = 0;     // number of valid entries in Cumulative and Window
+        uint32_t WindowSize = 0;        // length of the sliding window
+        ChannelStatistics Cumulative[RT_MAX_CHANNELS];
+        ChannelStatistics Window[RT_MAX_CHANNELS];
+    };
+
+    /// Per-channel mean, variance, min/max and RMS, updated in O(1) per sample.
+    /// Cumulative values use Welford's update. The sliding window replaces the oldest sample in the
+    /// same way and tracks min/max with monotonic queues. Results are published through a SeqLock, so
+    /// any thread can read them without locking. Memory is only allocated at construction.
+    class RTStatisticsAccumulator {
+    public:
+        /// \param window Length of the sliding window in samples
+        explicit RTStatisticsAccumulator(size_t window = 1000)
+                : _window(std::max<size_t>(window, 1)),
+                  _history(_window * RT_MAX_CHANNELS),
+                  _minQueue(_window * RT_MAX_CHANNELS),
+                  _maxQueue(_window * RT_MAX_CHANNELS) {
+            reset();
+        }
+
+        RTStatisticsAccumulator(const RTStatisticsAccumulator &) = delete;
+        RTStatisticsAccumulator &operator=(const RTStatisticsAccumulator &) = delete;
+
+        /// Request a reset. It is applied by the updating thread before the next block.
+        void requestReset() {
+            _resetRequested = true;
+        }
+
+        /// Forget all samples. Only call it from the updating thread or while no update runs.
+        void reset() {
+            _resetRequested = false;
+            _count = 0;
+            for (size_t c = 0; c < RT_MAX_CHANNELS; c++) {
+                _cumulative[c] = Accumulator();
+                _windowed[c] = Accumulator();
+                _minHead[c] = _minTail[c] = _maxHead[c] = _maxTail[c] = 0;
+            }
+            _snapshot.store(RTStatistics());
+        }
+
+        /// Add a block of samples and publish the updated statistics. Must only be called from one thread.
+        void add(const RTColumns &columns) {
+            if (_resetRequested)
+                reset();
+            if (columns.empty())
+                return;
+
+            size_t nChannel = std::min(columns.channels(), RT_MAX_CHANNELS);
+            for (size_t c = 0; c < nChannel; c++) {
+                const float *col = columns.channel(c);
+                float *history = &_history[c * _window];
+                uint64_t count = _count;
+                for (size_t i = 0; i < columns.size(); i++, count++) {
+                    double x = col[i];
+                    size_t pos = count % _window;
+
+                    _cumulative[c].add(x);
+                    if (count < _window) {
+                        _windowed[c].add(x);
+                    } else {
+                        _windowed[c].replace(history[pos], x);
+                    }
+                    history[pos] = static_cast<float>(x);
+
+                    pushMonotonic(&_minQueue[c * _window], _minHead[c], _minTail[c], count, x, true);
+                    pushMonotonic(&_maxQueue[c * _window], _maxHead[c], _maxTail[c], count, x, false);
+                }
+            }
+            _count += columns.size();
+
+            RTStatistics stats;
+            stats.Timestamp = columns.timestamps()[columns.size() - 1];
+            stats.ChannelNumber = nChannel;
+            stats.WindowSize = _window;
+            for (size_t c = 0; c < nChannel; c++) {
+                stats.Cumulative[c] = _cumulative[c].get();
+                stats.Window[c] = _windowed[c].get();
+                stats.Window[c].Min = _minQueue[c * _window + _minHead[c] % _window].Value;
+                stats.Window[c].Max = _maxQueue[c * _window + _maxHead[c] % _window].Value;
+            }
+            _snapshot.store(stats);
+        }
+
+        /// Get the latest statistics, safe from any thread
+        RTStatistics get() const {
+            return _snapshot.load();
+        }
+
+        size_t window() const {
+            return _window;
+        }
+
+    private:
+        /// Welford accumulator, also tracking the cumulative min/max
+        struct Accumulator {
+            uint64_t n = 0;
+            double mean = 0;
+            double m2 = 0;          // sum of squared deviations from the mean
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
+
+            void add(double x) {
+                n++;
+                double delta = x - mean;
+                mean += delta / n;
+                m2 += delta * (x - mean);
+                min = std::min(min, x);
+                max = std::max(max, x);
+            }
+
+            /// Replace an old sample by a new one, keeping n
+            void replace(double xOld, double xNew) {
+                double meanOld = mean;
+                mean += (xNew - xOld) / n;
+                m2 += (xNew - xOld) * (xNew - mean + xOld - meanOld);
+                if (m2 < 0)
+                    m2 = 0; // rounding
+            }
+
+            ChannelStatistics get() const {
+                ChannelStatistics s;
+                s.Count = n;
+                s.Mean = mean;
+                s.Variance = n > 0 ? m2 / n : 0;
+                s.Min = n > 0 ? min : 0;
+                s.Max = n > 0 ? max : 0;
+                s.Rms = std::sqrt(mean * mean + s.Variance);
+                return s;
+            }
+        };
+
+        struct QueueEntry {
+            uint64_t Index = 0;
+            double Value = 0;
+        };
+
+        /// Push a sample into a monotonic queue (ring of _window entries) and drop entries
+        /// that left the window or can no longer be the minimum (maximum)
+        void pushMonotonic(QueueEntry *queue, uint64_t &head, uint64_t &tail, uint64_t index, double x, bool isMin) {
+            while (tail > head && queue[head % _window].Index + _window <= index)
+                head++;
+            while (tail > head) {
+                double last = queue[(tail - 1) % _window].Value;
+                if (isMin ? last >= x : last <= x)
+                    tail--;
+                else
+                    break;
+            }
+            queue[tail % _window].Index = index;
+            queue[tail % _window].Value = x;
+            tail++;
+        }
+
+        size_t _window;                             // sliding window length
+        std::vector<float> _history;                // last _window samples per channel
+        std::vector<QueueEntry> _minQueue;          // monotonic queues for the window minimum, per channel
+        std::vector<QueueEntry> _maxQueue;          // monotonic queues for the window maximum, per channel
+        uint64_t _minHead[RT_MAX_CHANNELS], _minTail[RT_MAX_CHANNELS];
+        uint64_t _maxHead[RT_MAX_CHANNELS], _maxTail[RT_MAX_CHANNELS];
+        Accumulator _cumulative[RT_MAX_CHANNELS];   // since start
+        Accumulator _windowed[RT_MAX_CHANNELS];     // over the window
+        uint64_t _count = 0;                        // samples added since reset
+        std::atomic<bool> _resetRequested{false};   // set by requestReset() from any thread
+        SeqLock<RTStatistics> _snapshot;            // published statistics
+    }; // class RTStatisticsAccumulator
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_STATISTICS_HPP
@@ -0,0 +1,153 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_TARE_HPP
+#define SRI_FTSENSOR_SDK_TARE_HPP
+
+#include <sri/types.hpp>
+#include <sri/rtcolumns.hpp>
+#include <sri/seqlock.hpp>
+
+#include <atomic>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <mutex>
+#include <algorithm>
+
+namespace SRI {
+    /// Per-channel bias subtracted while decoding
+    struct RTBias {
+        bool Active = false;                // false if no bias is set
+        size_t Channels = 0;                // number of channels the bias was set or measured for
+        float Values[RT_MAX_CHANNELS] = {}; // bias of each channel in channelOrder
+    };
+
+    /// Host-side tare. The bias is read lock-free by the receiving thread for every frame.
+    /// A tare averages the next samples of the live stream, already corrected by the current bias,
+    /// and installs the corrected bias once enough samples have been seen.
+    class RTTare {
+    public:
+        RTTare() = default;
+
+        RTTare(const RTTare &) = delete;
+        RTTare &operator=(const RTTare &) = delete;
+
+        /// Start averaging the next nSamples samples. If a tare is already running, its future is returned.
+        /// \param nSamples Number of samples to average
+        /// \return         Becomes ready with the new bias once it is installed
+        std::shared_future<Offsets> start(size_t nSamples) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_taring)
+                return _future;
+
+            _target = std::max<size_t>(nSamples, 1);
+            _count = 0;
+            std::fill(_sum, _sum + RT_MAX_CHANNELS, 0.0);
+            _promise = std::promise<Offsets>();
+            _future = _promise.get_future().share();
+            _taring = true;
+            return _future;
+        }
+
+        bool isTaring() const {
+            return _taring;
+        }
+
+        /// Set the bias directly
+        /// \param offsets The bias of each channel in channelOrder, empty to clear it
+        void set(const Offsets &offsets) {
+            RTBias bias;
+            bias.Active = !offsets.empty();
+            bias.Channels = std::min(offsets.size(), RT_MAX_CHANNELS);
+            std::copy(offsets.begin(), offsets.begin() + std::min(offsets.size(), RT_MAX_CHANNELS), bias.Values);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bias.store(bias);
+        }
+
+        /// Get the bias of every channel, empty if no bias is set
+        Offsets get() const {
+            RTBias bias = _bias.load();
+            if (!bias.Active)
+                return Offsets();
+            return Offsets(bias.Values, bias.Values + bias.Channels);
+        }
+
+        /// End a running tare without installing a bias, its future throws std::runtime_error
+        /// \param reason The message of the exception
+        void cancel(const char *reason) {
+            if (!_taring)
+                return;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_taring)
+                return;
+            _taring = false;
+            _promise.set_exception(std::make_exception_ptr(std::runtime_error(reason)));
+        }
+
+        /// The bias for the decoder, lock-free
+        RTBias current() const {
+            return _bias.load();
+        }
+
+        /// Feed decoded samples while a tare is running. Called by the receiving thread.
+        void update(const RTColumns &columns) {
+            if (!_taring)
+                return;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            size_t nChannel = std::min(columns.channels(), RT_MAX_CHANNELS);
+            size_t n = std::min(columns.size(), _target - _count);
+            for (size_t c = 0; c < nChannel; c++) {
+                const float *col = columns.channel(c);
+                double sum = 0;
+                for (size_t i = 0; i < n; i++) {
+                    sum += col[i];
+                }
+                _sum[c] += sum;
+            }
+            _count += n;
+
+            if (_count == _target) {
+                RTBias bias = _bias.load();
+                bias.Active = true;
+                bias.Channels = nChannel;
+                for (size_t c = 0; c < nChannel; c++) {
+                    bias.Values[c] += static_cast<float>(_sum[c] / _count);
+                }
+                _bias.store(bias);
+                _taring = false;
+                _promise.set_value(Offsets(bias.Values, bias.Values + nChannel));
+            }
+        }
+
+    private:
+        SeqLock<RTBias> _bias;                  // installed bias, stores serialized by _mutex
+        std::mutex _mutex;                      // serializes writers and the tare state
+        std::atomic<bool> _taring{false};       // a tare is running
+        size_t _target = 0;                     // samples to average
+        size_t _count = 0;                      // samples averaged so far
+        double _sum[RT_MAX_CHANNELS] = {};      // sum of the averaged samples per channel
+        std::promise<Offsets> _promise;         // fulfilled when the tare completes
+        std::shared_future<Offsets> _future;    // handed out to callers of start()
+    }; // class RTTare
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_TARE_HPP
@@ -0,0 +1,102 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_TIMING_HPP
+#define SRI_FTSENSOR_SDK_TIMING_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace SRI {
+    /// Timing and dropped frames of the receiving thread since the start of real time data
+    struct RTTiming {
+        uint64_t Elapsed = 0;           // ns since the start
+        uint64_t Frames = 0;            // frames handled
+        uint64_t Samples = 0;           // samples decoded
+        double Load = 0;                // fraction of Elapsed spent reading and handling frames, 1 is one core
+        double FrameCost = 0;           // mean ns of reading and handling per frame
+        double MeanLatency = 0;         // mean ns from receiving a frame until its callback returned
+        uint64_t MaxLatency = 0;        // maximum of the above
+        uint64_t CorruptFrames = 0;     // frames dropped for a wrong checksum or CRC32
+    };
+
+    /// Counters behind RTTiming, written by the receiving thread only and readable from any thread.
+    /// A few clock reads per received buffer, so they are always on.
+    class RTTimingCounters {
+    public:
+        /// Start counting, called by the receiving thread when it starts
+        void reset(uint64_t now) {
+            _start.store(now, std::memory_order_relaxed);
+            _frames.store(0, std::memory_order_relaxed);
+            _samples.store(0, std::memory_order_relaxed);
+            _busy.store(0, std::memory_order_relaxed);
+            _latency.store(0, std::memory_order_relaxed);
+            _maxLatency.store(0, std::memory_order_relaxed);
+            _corruptFrames.store(0, std::memory_order_relaxed);
+        }
+
+        /// Account for the time between reading a buffer and handling its last frame
+        void addBusy(uint64_t ns) {
+            _busy.store(_busy.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        }
+
+        /// Account for a handled frame
+        /// \param samples  Number of samples in the frame
+        /// \param latency  ns from receiving the frame until its callback returned
+        void addFrame(uint64_t samples, uint64_t latency) {
+            _frames.store(_frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            _samples.store(_samples.load(std::memory_order_relaxed) + samples, std::memory_order_relaxed);
+            _latency.store(_latency.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+            if (latency > _maxLatency.load(std::memory_order_relaxed))
+                _maxLatency.store(latency, std::memory_order_relaxed);
+        }
+
+        void addCorruptFrame() {
+            _corruptFrames.store(_corruptFrames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        RTTiming get(uint64_t now) const {
+            RTTiming timing;
+            uint64_t start = _start.load(std::memory_order_relaxed);
+            timing.Elapsed = now > start ? now - start : 0;
+            timing.Frames = _frames.load(std::memory_order_relaxed);
+            timing.Samples = _samples.load(std::memory_order_relaxed);
+            uint64_t busy = _busy.load(std::memory_order_relaxed);
+            if (timing.Elapsed > 0)
+                timing.Load = double(busy) / timing.Elapsed;
+            if (timing.Frames > 0) {
+                timing.FrameCost = double(busy) / timing.Frames;
+                timing.MeanLatency = double(_latency.load(std::memory_order_relaxed)) / timing.Frames;
+            }
+            timing.MaxLatency = _maxLatency.load(std::memory_order_relaxed);
+            timing.CorruptFrames = _corruptFrames.load(std::memory_order_relaxed);
+            return timing;
+        }
+
+    private:
+        std::atomic<uint64_t> _start{0};        // steady clock in ns
+        std::atomic<uint64_t> _frames{0};
+        std::atomic<uint64_t> _samples{0};
+        std::atomic<uint64_t> _busy{0};         // ns spent reading and handling frames
+        std::atomic<uint64_t> _latency{0};      // sum over the frames
+        std::atomic<uint64_t> _maxLatency{0};
+        std::atomic<uint64_t> _corruptFrames{0};
+    }; // class RTTimingCounters
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_TIMING_HPP
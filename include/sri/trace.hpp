@@ -0,0 +1,245 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_TRACE_HPP
+#define SRI_FTSENSOR_SDK_TRACE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace SRI {
+    /// Stages of a frame's way from the socket to the callback
+    enum class TraceKind : uint32_t {
+        Socket,     // kernel receive time until the read started, only with SocketOptions::RxTimestamps
+        Read,       // reading from the transport, Arg of both is the number of buffered bytes
+        Validate,   // frame boundary found until the checksum or CRC32 has been checked
+        Decode,     // transposing the payload and subtracting the tare
+        Process,    // transform, trigger, filters, statistics and publishing
+        Handler,    // the callback, or pushing to the queue if one is used
+        Frame,      // frame boundary found until the callback returned, Arg is the frame number
+        Dispatch    // the callback in the dispatching thread of the queue, Arg counts the callbacks
+    };
+
+    inline const char *toString(TraceKind kind) {
+        switch (kind) {
+            case TraceKind::Socket: return "socket";
+            case TraceKind::Read: return "read";
+            case TraceKind::Validate: return "validate";
+            case TraceKind::Decode: return "decode";
+            case TraceKind::Process: return "process";
+            case TraceKind::Handler: return "handler";
+            case TraceKind::Frame: return "frame";
+            case TraceKind::Dispatch: return "dispatch";
+        }
+        return "unknown";
+    }
+
+    /// Name of the Arg of a span in the exported trace
+    inline const char *traceArgName(TraceKind kind) {
+        switch (kind) {
+            case TraceKind::Socket:
+            case TraceKind::Read: return "bytes";
+            case TraceKind::Dispatch: return "call";
+            default: return "frame";
+        }
+    }
+
+    struct TraceSpan {
+        TraceKind Kind = TraceKind::Frame;
+        uint64_t Begin = 0;     // steady clock in ns
+        uint64_t End = 0;
+        uint64_t Arg = 0;       // see TraceKind
+    };
+
+    /// Spans of one thread in a ring that keeps the newest ones. Written by that thread only, without locks or
+    /// allocations. snapshot() may run concurrently and skips the spans overwritten while it copies.
+    class TraceBuffer {
+    public:
+        TraceBuffer(const std::string &name, size_t capacity)
+                : _name(name), _capacity(capacity > 0 ? capacity : 1), _slots(_capacity) {}
+
+        void add(TraceKind kind, uint64_t begin, uint64_t end, uint64_t arg = 0) {
+            uint64_t index = _written.load(std::memory_order_relaxed);
+            Slot &slot = _slots[index % _capacity];
+            slot.Kind.store(uint32_t(kind), std::memory_order_relaxed);
+            slot.Begin.store(begin, std::memory_order_relaxed);
+            slot.End.store(end, std::memory_order_relaxed);
+            slot.Arg.store(arg, std::memory_order_relaxed);
+            _written.store(index + 1, std::memory_order_release);
+        }
+
+        /// Copy the retained spans, oldest first
+        void snapshot(std::vector<TraceSpan> &spans) const {
+            spans.clear();
+            uint64_t end = _written.load(std::memory_order_acquire);
+            uint64_t begin = end > _capacity ? end - _capacity : 0;
+            for (uint64_t i = begin; i < end; i++) {
+                const Slot &slot = _slots[i % _capacity];
+                TraceSpan span;
+                span.Kind = TraceKind(slot.Kind.load(std::memory_order_relaxed));
+                span.Begin = slot.Begin.load(std::memory_order_relaxed);
+                span.End = slot.End.load(std::memory_order_relaxed);
+                span.Arg = slot.Arg.load(std::memory_order_relaxed);
+                spans.push_back(span);
+            }
+            // the writer may have lapped the first spans while they were copied, including the slot of the
+            // span it is writing but has not counted yet
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t written = _written.load(std::memory_order_relaxed);
+            uint64_t valid = written + 1 > _capacity ? written + 1 - _capacity : 0;
+            if (valid > begin)
+                spans.erase(spans.begin(), spans.begin() + std::min<uint64_t>(valid - begin, spans.size()));
+        }
+
+        const std::string &name() const {
+            return _name;
+        }
+
+    private:
+        friend class RTTracer;
+
+        struct Slot {
+            std::atomic<uint32_t> Kind{0};
+            std::atomic<uint64_t> Begin{0};
+            std::atomic<uint64_t> End{0};
+            std::atomic<uint64_t> Arg{0};
+        };
+
+        std::string _name;                  // thread name in the trace
+        size_t _capacity;
+        std::vector<Slot> _slots;
+        std::atomic<uint64_t> _written{0};  // spans added so far
+        bool _leased = false;               // a thread writes to it, guarded by the tracer
+    }; // class TraceBuffer
+
+    /// Collects the spans of the SDK's threads, see FTSensor::setRealTimeDataTrace, and writes them in the
+    /// Chrome trace event format, which chrome://tracing and https://ui.perfetto.dev open.
+    class RTTracer {
+    public:
+        /// \param capacity Spans kept per thread, the oldest are overwritten
+        explicit RTTracer(size_t capacity = 65536) : _capacity(capacity), _origin(now()) {}
+
+        /// Get a buffer for a thread to write to until release(). A released buffer of the same name is reused,
+        /// otherwise a new one is created, so a thread started before the previous one ended gets its own.
+        /// Use TraceBufferLease to release it when the thread ends.
+        TraceBuffer *acquire(const std::string &threadName) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &buffer : _buffers) {
+                if (!buffer->_leased && buffer->name() == threadName) {
+                    buffer->_leased = true;
+                    return buffer.get();
+                }
+            }
+            _buffers.emplace_back(new TraceBuffer(threadName, _capacity));
+            _buffers.back()->_leased = true;
+            return _buffers.back().get();
+        }
+
+        /// Give a buffer back once its thread does not write to it anymore. Its spans stay in the trace.
+        void release(TraceBuffer *buffer) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            buffer->_leased = false;
+        }
+
+        /// Write the retained spans as Chrome trace JSON, safe while tracing
+        void writeChromeTrace(std::ostream &out) const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::vector<TraceSpan> spans;
+            char event[256];
+            bool first = true;
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            for (size_t t = 0; t < _buffers.size(); t++) {
+                std::snprintf(event, sizeof(event),
+                              "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"",
+                              first ? "" : ",", t + 1);
+                out << event << _buffers[t]->name() << "\"}}";
+                first = false;
+
+                _buffers[t]->snapshot(spans);
+                for (auto &span : spans) {
+                    std::snprintf(event, sizeof(event),
+                                  ",\n{\"name\":\"%s\",\"cat\":\"sri\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,"
+                                  "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"%s\":%llu}}",
+                                  toString(span.Kind), t + 1, span.Begin > _origin ? (span.Begin - _origin) / 1e3 : 0.0,
+                                  span.End > span.Begin ? (span.End - span.Begin) / 1e3 : 0.0,
+                                  traceArgName(span.Kind), (unsigned long long) span.Arg);
+                    out << event;
+                }
+            }
+            out << "\n]}\n";
+        }
+
+        /// Write the trace to a file
+        /// \return false if the file could not be written
+        bool exportChromeTrace(const std::string &path) const {
+            std::ofstream out(path.c_str());
+            if (!out)
+                return false;
+            writeChromeTrace(out);
+            return bool(out);
+        }
+
+    private:
+        static uint64_t now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        size_t _capacity;                                   // spans per thread
+        uint64_t _origin;                                   // steady clock at construction, time 0 of the trace
+        std::vector<std::unique_ptr<TraceBuffer>> _buffers;
+        mutable std::mutex _mutex;                          // guards _buffers
+    }; // class RTTracer
+
+    /// The buffer a thread writes its spans to, from construction until the thread ends
+    class TraceBufferLease {
+    public:
+        /// \param tracer     The tracer, nullptr for no tracing
+        /// \param threadName The name of the thread in the trace
+        TraceBufferLease(std::shared_ptr<RTTracer> tracer, const std::string &threadName)
+                : _tracer(std::move(tracer)), _buffer(_tracer ? _tracer->acquire(threadName) : nullptr) {}
+
+        ~TraceBufferLease() {
+            if (_buffer)
+                _tracer->release(_buffer);
+        }
+
+        TraceBufferLease(const TraceBufferLease &) = delete;
+        TraceBufferLease &operator=(const TraceBufferLease &) = delete;
+
+        /// \return The buffer, nullptr without tracer
+        TraceBuffer *get() const {
+            return _buffer;
+        }
+
+    private:
+        std::shared_ptr<RTTracer> _tracer;  // keeps the buffer alive
+        TraceBuffer *_buffer;
+    }; // class TraceBufferLease
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_TRACE_HPP
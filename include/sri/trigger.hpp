@@ -0,0 +1,238 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_TRIGGER_HPP
+#define SRI_FTSENSOR_SDK_TRIGGER_HPP
+
+#include <sri/types.hpp>
+#include <sri/rtcolumns.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <boost/function.hpp>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace SRI {
+    /// A condition on real time data that raises a TriggerEvent
+    struct TriggerRule {
+        enum class Source {
+            Channel,            // the value of Channel
+            ForceMagnitude,     // |(ch0, ch1, ch2)|, Fx Fy Fz for a 6-axis sensor
+            TorqueMagnitude     // |(ch3, ch4, ch5)|, Mx My Mz for a 6-axis sensor
+        };
+        enum class Condition {
+            Above,      // value > Threshold
+            Below,      // value < Threshold
+            RateAbove   // |value - previous value| > Threshold, change per sample
+        };
+
+        uint32_t Id = 0;                    // reported in the events of this rule
+        Source Input = Source::Channel;
+        uint16_t Channel = 0;               // index in channelOrder, for Source::Channel
+        Condition Type = Condition::Above;
+        float Threshold = 0;
+        float Hysteresis = 0;               // the rule is released only once the value is this far back
+        uint32_t Debounce = 1;              // consecutive samples that must meet the condition
+    };
+
+    /// A rule became active or was released
+    struct TriggerEvent {
+        uint32_t RuleId = 0;
+        bool Active = false;                // true when the condition is met, false when released
+        float Value = 0;                    // the value that crossed the threshold
+        uint64_t ReceiveTimestamp = 0;      // receive time of the frame in ns
+        uint64_t EventTimestamp = 0;        // time the event was raised in ns, same clock
+    };
+
+    /// Wire-to-event latency of the raised events, EventTimestamp - ReceiveTimestamp
+    struct TriggerLatency {
+        uint64_t Count = 0;
+        uint64_t Last = 0;  // ns
+        uint64_t Max = 0;   // ns
+        uint64_t Mean = 0;  // ns
+    };
+
+    /// Evaluates trigger rules on every decoded sample in the receiving thread and raises events
+    /// through a callback and, on Linux, an eventfd. Rules are set up before real time data starts.
+    class RTTrigger {
+    public:
+        typedef boost::function<void(const TriggerEvent&)> EventHandler;
+
+        RTTrigger() = default;
+
+        ~RTTrigger() {
+#ifdef __linux__
+            if (_eventFd >= 0)
+                ::close(_eventFd);
+#endif
+        }
+
+        RTTrigger(const RTTrigger &) = delete;
+        RTTrigger &operator=(const RTTrigger &) = delete;
+
+        void addRule(const TriggerRule &rule) {
+            _rules.push_back(State());
+            _rules.back().Rule = rule;
+            _rules.back().Rule.Debounce = std::max<uint32_t>(rule.Debounce, 1);
+        }
+
+        void clearRules() {
+            _rules.clear();
+        }
+
+        /// Called in the receiving thread for every event, keep it short
+        void setHandler(EventHandler handler) {
+            _handler = handler;
+        }
+
+#ifdef __linux__
+        /// Get an eventfd that is incremented whenever a rule becomes active, for poll/epoll based consumers
+        /// \return The file descriptor, or -1 on failure
+        int getEventFd() {
+            if (_eventFd < 0)
+                _eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            return _eventFd;
+        }
+#endif
+
+        /// Forget the state of all rules, called when real time data starts
+        void reset() {
+            for (auto &state : _rules) {
+                state.Active = false;
+                state.Count = 0;
+                state.Primed = false;
+            }
+        }
+
+        /// Evaluate all rules on a block of samples. Called by the receiving thread.
+        void process(const RTColumns &columns) {
+            for (size_t i = 0; i < columns.size(); i++) {
+                for (auto &state : _rules) {
+                    float value = getValue(state.Rule, columns, i);
+                    evaluate(state, value, columns.timestamps()[i]);
+                }
+            }
+        }
+
+        /// Get the wire-to-event latency, safe from any thread
+        TriggerLatency getLatency() const {
+            TriggerLatency latency;
+            latency.Count = _latencyCount.load(std::memory_order_relaxed);
+            latency.Last = _latencyLast.load(std::memory_order_relaxed);
+            latency.Max = _latencyMax.load(std::memory_order_relaxed);
+            latency.Mean = latency.Count > 0 ? _latencySum.load(std::memory_order_relaxed) / latency.Count : 0;
+            return latency;
+        }
+
+    private:
+        struct State {
+            TriggerRule Rule;
+            bool Active = false;    // the condition is met
+            uint32_t Count = 0;     // consecutive samples meeting (or, when active, no longer meeting) it
+            bool Primed = false;    // Previous is valid
+            float Previous = 0;     // last value, for Condition::RateAbove
+        };
+
+        static float getValue(const TriggerRule &rule, const RTColumns &columns, size_t i) {
+            switch (rule.Input) {
+                case TriggerRule::Source::ForceMagnitude:
+                case TriggerRule::Source::TorqueMagnitude: {
+                    size_t first = rule.Input == TriggerRule::Source::ForceMagnitude ? 0 : 3;
+                    if (columns.channels() < first + 3)
+                        return 0;
+                    float x = columns(first, i), y = columns(first + 1, i), z = columns(first + 2, i);
+                    return std::sqrt(x * x + y * y + z * z);
+                }
+                default:
+                    return rule.Channel < columns.channels() ? columns(rule.Channel, i) : 0;
+            }
+        }
+
+        void evaluate(State &state, float value, uint64_t receiveTimestamp) {
+            const TriggerRule &rule = state.Rule;
+            float measure = value;
+            if (rule.Type == TriggerRule::Condition::RateAbove) {
+                measure = state.Primed ? std::fabs(value - state.Previous) : 0;
+                state.Previous = value;
+                state.Primed = true;
+            }
+
+            bool met, released;
+            if (rule.Type == TriggerRule::Condition::Below) {
+                met = measure < rule.Threshold;
+                released = measure >= rule.Threshold + rule.Hysteresis;
+            } else {
+                met = measure > rule.Threshold;
+                released = measure <= rule.Threshold - rule.Hysteresis;
+            }
+
+            // count consecutive samples towards the opposite state, the debounce applies in both directions
+            bool toward = state.Active ? released : met;
+            state.Count = toward ? state.Count + 1 : 0;
+            if (state.Count < rule.Debounce)
+                return;
+
+            state.Active = !state.Active;
+            state.Count = 0;
+            raise(rule.Id, state.Active, value, receiveTimestamp);
+        }
+
+        void raise(uint32_t id, bool active, float value, uint64_t receiveTimestamp) {
+            TriggerEvent event;
+            event.RuleId = id;
+            event.Active = active;
+            event.Value = value;
+            event.ReceiveTimestamp = receiveTimestamp;
+            event.EventTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+
+#ifdef __linux__
+            if (active && _eventFd >= 0) {
+                uint64_t one = 1;
+                ssize_t n = ::write(_eventFd, &one, sizeof(one));
+                (void) n;
+            }
+#endif
+            if (_handler)
+                _handler(event);
+
+            uint64_t latency = event.EventTimestamp - receiveTimestamp;
+            _latencyLast.store(latency, std::memory_order_relaxed);
+            _latencySum.fetch_add(latency, std::memory_order_relaxed);
+            _latencyCount.fetch_add(1, std::memory_order_relaxed);
+            if (latency > _latencyMax.load(std::memory_order_relaxed))
+                _latencyMax.store(latency, std::memory_order_relaxed);
+        }
+
+        std::vector<State> _rules;                  // rules and their state
+        EventHandler _handler;                      // optional event callback
+        int _eventFd = -1;                          // optional eventfd
+        std::atomic<uint64_t> _latencyCount{0};     // number of events
+        std::atomic<uint64_t> _latencyLast{0};      // latency of the last event in ns
+        std::atomic<uint64_t> _latencyMax{0};       // maximum latency in ns
+        std::atomic<uint64_t> _latencySum{0};       // sum of latencies in ns
+    }; // class RTTrigger
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_TRIGGER_HPP
@@ -24,6 +24,7 @@ Shenyang Institute of Automation, Chinese Academy of Sciences.
 #ifndef SRI_FTSENSOR_SDK_TYPES_HPP
 #define SRI_FTSENSOR_SDK_TYPES_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -111,10 +112,31 @@ namespace SRI {
 
     typedef std::string RTDataValid; // data validation method when getting one package data from M8128. SUM or CRC32
 
+    /// RTDataValid resolved once before decoding
+    enum class RTValidation {
+        Sum,    // 1 byte sum of the payload
+        Crc32,  // 4 bytes CRC32 of the payload
+        None    // unknown method, 1 byte that is not checked
+    };
+
+    inline RTValidation toRTValidation(const RTDataValid &rtValid) {
+        if (rtValid == "SUM")
+            return RTValidation::Sum;
+        if (rtValid == "CRC32")
+            return RTValidation::Crc32;
+        return RTValidation::None;
+    }
+
+    /// Number of bytes following the payload of a frame
+    inline uint32_t parityBytes(RTValidation validation) {
+        return validation == RTValidation::Crc32 ? 4 : 1;
+    }
+
     template<typename T>
     struct RTData {
         uint16_t DataNumber;
         std::vector<T> Data;
+        uint64_t Timestamp = 0; // Receive time of the frame, steady clock in ns.
 //        uint8_t FrameHeader[2] = {0xAA, 0x55};
 //        uint16_t PackLength;
 //        uint8_t Checksum;
@@ -131,6 +153,24 @@ namespace SRI {
         }
     };
 
+    const size_t RT_MAX_CHANNELS = 8; // M8128 provides at most 8 analog channels
+
+    /// Fixed-size copy of one decoded sample, used where RTData's heap vector does not fit (lock-free publishing).
+    struct RTSample {
+        uint64_t Timestamp = 0;           // Receive time of the frame, steady clock in ns.
+        uint64_t Sequence = 0;            // Running number of the sample, 0 if no sample has been received yet.
+        uint16_t ChannelNumber = 0;       // Number of valid entries in Data.
+        float Data[RT_MAX_CHANNELS] = {}; // Channel values in channelOrder. AD counts are represented exactly.
+
+        float& operator[](int index) {
+            return Data[index];
+        }
+
+        const float& operator[](int index) const {
+            return Data[index];
+        }
+    };
+
 }
 
 #endif //SRI_FTSENSOR_SDK_TYPES_HPP
@@ -0,0 +1,145 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SRI_FTSENSOR_SDK_WRENCHTRANSFORM_HPP
+#define SRI_FTSENSOR_SDK_WRENCHTRANSFORM_HPP
+
+#include <sri/rtcolumns.hpp>
+#include <sri/filter.hpp>
+#include <sri/seqlock.hpp>
+
+#include <mutex>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace SRI {
+    /// 6x6 matrix mapping (Fx, Fy, Fz, Mx, My, Mz) of the sensor frame to another frame, row-major
+    struct WrenchMatrix {
+        float M[36] = {1, 0, 0, 0, 0, 0,
+                       0, 1, 0, 0, 0, 0,
+                       0, 0, 1, 0, 0, 0,
+                       0, 0, 0, 1, 0, 0,
+                       0, 0, 0, 0, 1, 0,
+                       0, 0, 0, 0, 0, 1};
+    };
+
+    /// Transforms the wrench in the first six channels (Fx, Fy, Fz, Mx, My, Mz) into a tool or base frame.
+    /// The 6x6 matrix is precomputed from the mounting transform and can be replaced at any time from
+    /// any thread; the receiving thread picks it up lock-free at the next frame.
+    class WrenchTransform : public RTFilterStage {
+    public:
+        WrenchTransform() = default;
+
+        /// \param rotation     Orientation of the sensor frame in the target frame, row-major 3x3
+        /// \param translation  Origin of the sensor frame in the target frame
+        WrenchTransform(const float rotation[9], const float translation[3]) {
+            setTransform(rotation, translation);
+        }
+
+        /// Set the mounting transform. f' = R f, m' = R m + p x (R f).
+        /// \param rotation     Orientation of the sensor frame in the target frame, row-major 3x3
+        /// \param translation  Origin of the sensor frame in the target frame
+        void setTransform(const float rotation[9], const float translation[3]) {
+            const float *R = rotation;
+            const float *p = translation;
+            // skew-symmetric matrix of p times R
+            float pR[9];
+            for (int j = 0; j < 3; j++) {
+                pR[0 * 3 + j] = -p[2] * R[1 * 3 + j] + p[1] * R[2 * 3 + j];
+                pR[1 * 3 + j] = p[2] * R[0 * 3 + j] - p[0] * R[2 * 3 + j];
+                pR[2 * 3 + j] = -p[1] * R[0 * 3 + j] + p[0] * R[1 * 3 + j];
+            }
+
+            WrenchMatrix matrix;
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    matrix.M[i * 6 + j] = R[i * 3 + j];
+                    matrix.M[i * 6 + j + 3] = 0;
+                    matrix.M[(i + 3) * 6 + j] = pR[i * 3 + j];
+                    matrix.M[(i + 3) * 6 + j + 3] = R[i * 3 + j];
+                }
+            }
+            setMatrix(matrix);
+        }
+
+        /// Set the 6x6 matrix directly
+        void setMatrix(const WrenchMatrix &matrix) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _matrix.store(matrix);
+        }
+
+        WrenchMatrix getMatrix() const {
+            return _matrix.load();
+        }
+
+        void reset() override {}
+
+        /// Transform a block of samples in place, needs at least six channels
+        void process(RTColumns &columns) override {
+            if (columns.channels() < 6 || columns.empty())
+                return;
+
+            const WrenchMatrix matrix = _matrix.load(); // one consistent matrix per block
+            const float *A = matrix.M;
+            float *col[6];
+            for (int c = 0; c < 6; c++) {
+                col[c] = columns.channel(c);
+            }
+
+            size_t i = 0;
+#ifdef __SSE2__
+            // 4 samples at a time, every column is contiguous so loads and stores are plain vector moves
+            for (; i + 4 <= columns.size(); i += 4) {
+                __m128 in[6];
+                for (int c = 0; c < 6; c++) {
+                    in[c] = _mm_loadu_ps(col[c] + i);
+                }
+                for (int r = 0; r < 6; r++) {
+                    __m128 acc = _mm_mul_ps(_mm_set1_ps(A[r * 6]), in[0]);
+                    for (int c = 1; c < 6; c++) {
+                        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(A[r * 6 + c]), in[c]));
+                    }
+                    _mm_storeu_ps(col[r] + i, acc);
+                }
+            }
+#endif
+            for (; i < columns.size(); i++) {
+                float in[6];
+                for (int c = 0; c < 6; c++) {
+                    in[c] = col[c][i];
+                }
+                for (int r = 0; r < 6; r++) {
+                    float acc = 0;
+                    for (int c = 0; c < 6; c++) {
+                        acc += A[r * 6 + c] * in[c];
+                    }
+                    col[r][i] = acc;
+                }
+            }
+        }
+
+    private:
+        SeqLock<WrenchMatrix> _matrix;  // current matrix, read lock-free per block
+        std::mutex _mutex;              // serializes writers
+    }; // class WrenchTransform
+} //namespace SRI
+
+
+#endif //SRI_FTSENSOR_SDK_WRENCHTRANSFORM_HPP
@@ -0,0 +1,578 @@
+//
+// Soak and stress run of FTSensor against a local M8128 stand-in (Linux), built with -DSRI_FTSENSOR_SDK_SOAK=ON:
+//     ./soak --duration 3600 --rate 10000 --pnpch 1
+// Without faults, the receiving path is checked to be free of allocations per frame:
+//     ./soak --duration 60 --faults 0 --max-allocs-per-frame 0
+// The stand-in streams sequence-tagged samples as fast as asked and injects split frames, corrupted checksums,
+// bursts and disconnects. Every report interval the run prints samples, losses, RSS, allocations and latency
+// percentiles, and it exits with 1 on lost or duplicated samples, stalls, memory growth, slow delivery or when
+// the SDK's gap detection disagrees with the samples found missing.
+//
+
+#include <sri/ftsensor.hpp>
+#include <sri/commethernet.hpp>
+#include <boost/format.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace SRI;
+
+/* ALLOCATION TRACKING */
+static std::atomic<uint64_t> allocations{0};   // calls of operator new
+static std::atomic<int64_t> liveAllocations{0}; // not yet deleted
+
+void *operator new(size_t n) {
+    void *p = std::malloc(n > 0 ? n : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    liveAllocations.fetch_add(1, std::memory_order_relaxed);
+    return p;
+}
+
+void *operator new[](size_t n) {
+    return operator new(n);
+}
+
+void operator delete(void *p) noexcept {
+    if (p == nullptr)
+        return;
+    liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Resident set size in bytes
+static uint64_t residentSetSize() {
+    unsigned long pages = 0, resident = 0;
+    FILE *f = std::fopen("/proc/self/statm", "r");
+    if (f != nullptr) {
+        if (std::fscanf(f, "%lu %lu", &pages, &resident) != 2)
+            resident = 0;
+        std::fclose(f);
+    }
+    return uint64_t(resident) * uint64_t(sysconf(_SC_PAGESIZE));
+}
+
+struct SoakOptions {
+    uint32_t Duration = 60;             // s
+    uint32_t Report = 10;               // s between reports
+    uint32_t Warmup = 1;                // reports before the memory baselines are taken
+    uint32_t Rate = 5000;               // samples per second
+    uint16_t PNpCH = 1;                 // samples per frame
+    uint16_t Port = 47008;
+    bool Faults = true;
+    double SplitProbability = 0.05;     // per frame, sent in two writes
+    double CorruptProbability = 1e-4;   // per frame, wrong checksum
+    uint32_t BurstEvery = 7;            // s, the stand-in pauses and then sends the backlog at once, 0 for none
+    uint32_t BurstMs = 50;              // length of the pause
+    uint32_t DisconnectEvery = 30;      // s, the stand-in drops the connection, 0 for never
+    double MaxRssGrowthMb = 4;          // after the warmup
+    int64_t MaxLiveGrowth = 1000;       // live allocations after the warmup
+    double MaxAllocsPerFrame = -1;      // allocations per received frame after the warmup, in intervals without
+                                        // reconnects, negative for no check. 0 checks the allocation-free path
+    double MaxP99GrowthUs = 5000;       // p99 latency from sending to the callback per report interval,
+                                        // above the p99 of the last warmup interval
+    uint32_t StallMs = 1000;            // maximum time without samples, unless the stand-in disconnected
+};
+
+/// Minimal M8128: answers SGDM, starts and stops GSD streaming and tags every sample with its sequence number,
+/// channel 0 holding the low and channel 1 the high 16 bits. Runs a thread serving one connection at a time.
+class M8128StandIn {
+public:
+    static const size_t SEND_TIMES = 1 << 16;   // send times kept, indexed by sequence
+
+    explicit M8128StandIn(const SoakOptions &options) : _options(options), _sendTimes(SEND_TIMES) {
+        _frame.reserve(6 + RT_MAX_CHANNELS * sizeof(float) * 1024 + 1);
+    }
+
+    ~M8128StandIn() {
+        _running = false;
+        if (_listener >= 0)
+            ::shutdown(_listener, SHUT_RDWR);
+        if (_thread.joinable())
+            _thread.join();
+        if (_listener >= 0)
+            ::close(_listener);
+    }
+
+    bool start() {
+        _listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        ::setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(_options.Port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(_listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::listen(_listener, 1) != 0) {
+            std::perror("M8128StandIn");
+            return false;
+        }
+        _running = true;
+        _thread = std::thread(&M8128StandIn::run, this);
+        return true;
+    }
+
+    /// Send time in ns of the frame holding a sample
+    uint64_t sendTime(uint64_t sequence) const {
+        return _sendTimes[sequence % SEND_TIMES].load(std::memory_order_acquire);
+    }
+
+    uint64_t corruptedSamples() const {
+        return _corruptedSamples;
+    }
+
+    uint64_t disconnects() const {
+        return _disconnects;
+    }
+
+private:
+    void run() {
+        while (_running) {
+            int fd = ::accept(_listener, nullptr, nullptr);
+            if (fd < 0)
+                break;
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            serve(fd);
+            ::close(fd);
+        }
+    }
+
+    void serve(int fd) {
+        std::string commands;
+        bool streaming = false;
+        uint64_t streamStart = 0, sentFrames = 0;
+        uint64_t connected = now();
+        uint64_t nextBurst = connected + _options.BurstEvery * 1000000000ull;
+        uint64_t disconnectAt = connected + _options.DisconnectEvery * 1000000000ull;
+        char buf[512];
+
+        while (_running) {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n == 0)
+                return; // closed by the client
+            if (n > 0)
+                commands.append(buf, size_t(n));
+            size_t end;
+            while ((end = commands.find("\r\n")) != std::string::npos) {
+                std::string command = commands.substr(0, end);
+                commands.erase(0, end + 2);
+                if (command == "AT+GSD") {
+                    streaming = true;
+                    streamStart = now();
+                    sentFrames = 0;
+                } else if (command == "AT+GSD=STOP") {
+                    streaming = false;
+                } else if (command.compare(0, 8, "AT+SGDM=") == 0 && command != "AT+SGDM=?") {
+                    size_t unit = command.find(");");
+                    if (unit != std::string::npos)
+                        _pnpch = uint16_t(std::max(1, std::atoi(command.c_str() + unit + 4)));
+                    if (!sendAll(fd, "ACK+SGDM=" + command.substr(8) + "$OK\r\n"))
+                        return;
+                }
+            }
+
+            uint64_t t = now();
+            if (_options.Faults && _options.DisconnectEvery > 0 && t >= disconnectAt) {
+                _disconnects++;
+                return;
+            }
+            if (_options.Faults && _options.BurstEvery > 0 && streaming && t >= nextBurst) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(_options.BurstMs));
+                nextBurst = t + _options.BurstEvery * 1000000000ull;
+            }
+            if (streaming) {
+                uint64_t due = (now() - streamStart) * _options.Rate / _pnpch / 1000000000ull;
+                for (; sentFrames < due; sentFrames++) {
+                    if (!sendFrame(fd))
+                        return;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    /// Build and send the next frame, AA 55 <length> <sequence> <payload> <checksum>
+    bool sendFrame(int fd) {
+        const size_t nChannel = 6;
+        size_t dataLen = nChannel * sizeof(float) * _pnpch;
+        size_t packageLength = 2 + dataLen + 1;
+        _frame.resize(4 + packageLength);
+        _frame[0] = char(0xAA);
+        _frame[1] = char(0x55);
+        _frame[2] = char(packageLength >> 8);
+        _frame[3] = char(packageLength & 0xFF);
+        _frame[4] = char((_nextSample >> 8) & 0xFF);
+        _frame[5] = char(_nextSample & 0xFF);
+        for (uint16_t i = 0; i < _pnpch; i++) {
+            uint64_t sequence = _nextSample + i;
+            float sample[nChannel] = {float(sequence & 0xFFFF), float(sequence >> 16), 2, 3, 4, 5};
+            std::memcpy(&_frame[6 + i * sizeof(sample)], sample, sizeof(sample));
+        }
+        uint8_t sum = 0;
+        for (size_t i = 0; i < dataLen; i++)
+            sum += uint8_t(_frame[6 + i]);
+        _frame[6 + dataLen] = char(sum);
+
+        if (_options.Faults && random() < _options.CorruptProbability) {
+            _frame[6 + dataLen] = char(sum ^ 0x5A);
+            _corruptedSamples += _pnpch;
+        }
+        uint64_t last = _nextSample + _pnpch - 1;
+        _nextSample += _pnpch;
+        _sendTimes[last % SEND_TIMES].store(now(), std::memory_order_release);
+
+        if (_options.Faults && random() < _options.SplitProbability) {
+            size_t half = _frame.size() / 2;
+            if (!sendAll(fd, _frame.data(), half))
+                return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            return sendAll(fd, _frame.data() + half, _frame.size() - half);
+        }
+        return sendAll(fd, _frame.data(), _frame.size());
+    }
+
+    static bool sendAll(int fd, const std::string &data) {
+        return sendAll(fd, data.data(), data.size());
+    }
+
+    static bool sendAll(int fd, const char *data, size_t n) {
+        while (n > 0) {
+            ssize_t sent = ::send(fd, data, n, MSG_NOSIGNAL);
+            if (sent <= 0)
+                return false;
+            data += sent;
+            n -= size_t(sent);
+        }
+        return true;
+    }
+
+    /// Uniform in [0, 1), xorshift64
+    double random() {
+        _random ^= _random << 13;
+        _random ^= _random >> 7;
+        _random ^= _random << 17;
+        return double(_random >> 11) / double(1ull << 53);
+    }
+
+    SoakOptions _options;
+    int _listener = -1;
+    std::atomic<bool> _running{false};
+    std::thread _thread;
+    std::string _frame;                                 // frame being sent, reused
+    uint16_t _pnpch = 1;                                // set by AT+SGDM
+    uint64_t _nextSample = 0;                           // continues across connections
+    uint64_t _random = 0x9E3779B97F4A7C15ull;
+    std::vector<std::atomic<uint64_t>> _sendTimes;      // by sequence % SEND_TIMES
+    std::atomic<uint64_t> _corruptedSamples{0};
+    std::atomic<uint64_t> _disconnects{0};
+}; // class M8128StandIn
+
+/// Log-linear latency histogram, 16 buckets per power of two, written by one thread and read by another
+class LatencyHistogram {
+public:
+    static const size_t BUCKETS = 61 * 16;
+
+    LatencyHistogram() : _counts(BUCKETS) {}
+
+    void add(uint64_t ns) {
+        std::atomic<uint64_t> &count = _counts[bucket(ns)];
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void snapshot(std::vector<uint64_t> &counts) const {
+        counts.resize(BUCKETS);
+        for (size_t i = 0; i < BUCKETS; i++)
+            counts[i] = _counts[i].load(std::memory_order_relaxed);
+    }
+
+    /// Percentile of the samples counted between two snapshots
+    /// \return The upper bound of the bucket in ns, 0 without samples
+    static uint64_t percentile(const std::vector<uint64_t> &from, const std::vector<uint64_t> &to, double p) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < BUCKETS; i++)
+            total += to[i] - from[i];
+        if (total == 0)
+            return 0;
+        uint64_t rank = uint64_t(p * (total - 1)) + 1, seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += to[i] - from[i];
+            if (seen >= rank)
+                return upperBound(i);
+        }
+        return upperBound(BUCKETS - 1);
+    }
+
+private:
+    static size_t bucket(uint64_t ns) {
+        if (ns < 16)
+            return size_t(ns);
+        int exponent = 63 - __builtin_clzll(ns); // >= 4
+        size_t index = size_t(exponent - 3) * 16 + size_t((ns >> (exponent - 4)) & 15);
+        return std::min(index, BUCKETS - 1);
+    }
+
+    static uint64_t upperBound(size_t index) {
+        if (index < 16)
+            return index + 1;
+        int exponent = int(index / 16) + 3;
+        return (uint64_t(16 + index % 16 + 1) << (exponent - 4));
+    }
+
+    std::vector<std::atomic<uint64_t>> _counts;
+}; // class LatencyHistogram
+
+/// Checks the sequence of the received samples in the receiving thread
+class SampleChecker {
+public:
+    explicit SampleChecker(const M8128StandIn &standIn) : _standIn(standIn) {}
+
+    void check(const RTColumns &columns) {
+        if (columns.empty())
+            return;
+        for (size_t i = 0; i < columns.size(); i++) {
+            uint64_t sequence = uint64_t(columns(0, i)) + (uint64_t(columns(1, i)) << 16);
+            if (_restart) {
+                _restart = false;
+            } else if (sequence <= _last) {
+                _duplicated++;
+            } else if (sequence > _last + 1) {
+                _lost += sequence - _last - 1;
+            }
+            _last = sequence;
+        }
+        uint64_t t = now();
+        _samples += columns.size();
+        _lastReceived = t;
+        uint64_t sent = _standIn.sendTime(_last);
+        _latency.add(t > sent ? t - sent : 0);
+    }
+
+    /// The next sample starts a new connection, the gap to the previous one is not counted
+    void restart() {
+        _restart = true;
+        _lastReceived = now();
+    }
+
+    uint64_t samples() const { return _samples; }
+
+    uint64_t lost() const { return _lost; }
+
+    uint64_t duplicated() const { return _duplicated; }
+
+    uint64_t lastReceived() const { return _lastReceived; }
+
+    const LatencyHistogram &latency() const { return _latency; }
+
+private:
+    const M8128StandIn &_standIn;
+    std::atomic<bool> _restart{true};
+    uint64_t _last = 0;                         // receiving thread only
+    std::atomic<uint64_t> _samples{0};
+    std::atomic<uint64_t> _lost{0};             // samples missing within a connection
+    std::atomic<uint64_t> _duplicated{0};       // samples not newer than their predecessor
+    std::atomic<uint64_t> _lastReceived{0};     // steady clock in ns
+    LatencyHistogram _latency;
+}; // class SampleChecker
+
+static bool parseOptions(int argc, char **argv, SoakOptions &options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        double value = std::atof(argv[i + 1]);
+        if (name == "--duration") options.Duration = uint32_t(value);
+        else if (name == "--report") options.Report = std::max(1u, uint32_t(value));
+        else if (name == "--warmup") options.Warmup = uint32_t(value);
+        else if (name == "--rate") options.Rate = std::max(1u, uint32_t(value));
+        else if (name == "--pnpch") options.PNpCH = uint16_t(std::max(1.0, value));
+        else if (name == "--port") options.Port = uint16_t(value);
+        else if (name == "--faults") options.Faults = value != 0;
+        else if (name == "--split") options.SplitProbability = value;
+        else if (name == "--corrupt") options.CorruptProbability = value;
+        else if (name == "--burst-every") options.BurstEvery = uint32_t(value);
+        else if (name == "--disconnect-every") options.DisconnectEvery = uint32_t(value);
+        else if (name == "--max-rss-growth-mb") options.MaxRssGrowthMb = value;
+        else if (name == "--max-live-growth") options.MaxLiveGrowth = int64_t(value);
+        else if (name == "--max-allocs-per-frame") options.MaxAllocsPerFrame = value;
+        else if (name == "--max-p99-growth-us") options.MaxP99GrowthUs = value;
+        else if (name == "--stall-ms") options.StallMs = uint32_t(value);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::unique_ptr<FTSensor> connect(const SoakOptions &options, SampleChecker &checker) {
+    std::unique_ptr<FTSensor> sensor(new FTSensor(new CommEthernet("127.0.0.1", options.Port)));
+    RTDataMode rtMode;
+    rtMode.DataUnit = 'E';
+    rtMode.PNpCH = options.PNpCH;
+    if (!sensor->setRealTimeDataMode(rtMode))
+        return nullptr;
+    checker.restart();
+    sensor->startRealTimeDataColumns<float>([&checker](RTColumns &columns) { checker.check(columns); }, rtMode);
+    return sensor;
+}
+
+/// Stop and destroy the sensor once its threads have finished
+/// \return false if they are still running, the sensor is then left alive
+static bool disconnect(std::unique_ptr<FTSensor> &sensor) {
+    sensor->stopRealTimeDataRepeatedly();
+    if (!sensor->waitRealTimeDataFinished()) {
+        sensor.release();
+        return false;
+    }
+    sensor.reset();
+    return true;
+}
+
+int main(int argc, char **argv) {
+    SoakOptions options;
+    if (!parseOptions(argc, argv, options))
+        return 2;
+
+    M8128StandIn standIn(options);
+    if (!standIn.start())
+        return 2;
+    SampleChecker checker(standIn);
+    std::unique_ptr<FTSensor> sensor = connect(options, checker);
+    if (!sensor) {
+        std::fprintf(stderr, "cannot configure the stand-in\n");
+        return 2;
+    }
+
+    std::vector<std::string> failures;
+    std::vector<uint64_t> previous, current;
+    checker.latency().snapshot(previous);
+    uint64_t start = now(), nextReport = start + options.Report * 1000000000ull;
+    uint64_t seenDisconnects = 0, reconnects = 0, previousAllocations = allocations, previousSamples = 0;
+    uint64_t previousReconnects = 0;
+    uint64_t reportedLost = 0; // lost samples found by the SDK's gap detection in the finished connections
+    uint64_t baseRss = 0, baseP99 = 0;
+    int64_t baseLive = 0;
+    uint32_t reports = 0;
+
+    std::printf("%8s %12s %8s %6s %8s %6s %9s %9s %9s %8s %8s %8s %8s\n", "time[s]", "samples", "lost", "dup",
+                "corrupt", "reconn", "rss[MB]", "live", "allocs/s", "p50[us]", "p99[us]", "p999[us]", "max[us]");
+    while (failures.empty() && now() - start < options.Duration * 1000000000ull) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        uint64_t t = now();
+
+        if (t - checker.lastReceived() > options.StallMs * 1000000ull) {
+            if (standIn.disconnects() == seenDisconnects) {
+                failures.push_back("stall: no samples for " + std::to_string(options.StallMs) + " ms");
+                break;
+            }
+            seenDisconnects = standIn.disconnects();
+            reportedLost += sensor->getRealTimeDataGaps().LostSamples;
+            if (!disconnect(sensor)) {
+                failures.push_back("the receiving thread did not finish");
+                break;
+            }
+            sensor = connect(options, checker);
+            reconnects++;
+            if (!sensor) {
+                failures.push_back("reconnecting failed");
+                break;
+            }
+        }
+
+        if (t < nextReport)
+            continue;
+        nextReport += options.Report * 1000000000ull;
+        reports++;
+
+        checker.latency().snapshot(current);
+        uint64_t p50 = LatencyHistogram::percentile(previous, current, 0.5);
+        uint64_t p99 = LatencyHistogram::percentile(previous, current, 0.99);
+        uint64_t p999 = LatencyHistogram::percentile(previous, current, 0.999);
+        uint64_t pMax = LatencyHistogram::percentile(previous, current, 1.0);
+        previous.swap(current);
+        uint64_t rss = residentSetSize();
+        int64_t live = liveAllocations;
+        uint64_t allocated = allocations;
+        std::printf("%8.0f %12lu %8lu %6lu %8lu %6lu %9.2f %9ld %9.1f %8.0f %8.0f %8.0f %8.0f\n",
+                    (t - start) / 1e9, (unsigned long) checker.samples(), (unsigned long) checker.lost(),
+                    (unsigned long) checker.duplicated(), (unsigned long) standIn.corruptedSamples(),
+                    (unsigned long) reconnects, rss / 1048576.0, (long) live,
+                    double(allocated - previousAllocations) / options.Report, p50 / 1e3, p99 / 1e3, p999 / 1e3,
+                    pMax / 1e3);
+        std::fflush(stdout);
+        uint64_t frames = (checker.samples() - previousSamples) / options.PNpCH;
+        if (options.MaxAllocsPerFrame >= 0 && reports > options.Warmup && reconnects == previousReconnects &&
+            double(allocated - previousAllocations) > options.MaxAllocsPerFrame * double(frames))
+            failures.push_back(boost::str(boost::format("%lu allocations for %lu frames")
+                                          % (allocated - previousAllocations) % frames));
+        previousAllocations = allocated;
+        previousReconnects = reconnects;
+
+        if (checker.duplicated() > 0)
+            failures.push_back("duplicated samples");
+        if (checker.lost() > standIn.corruptedSamples())
+            failures.push_back("lost samples not explained by corrupted frames");
+        if (checker.samples() == previousSamples)
+            failures.push_back("no samples in the last interval");
+        previousSamples = checker.samples();
+        if (reports == options.Warmup) {
+            baseRss = rss;
+            baseLive = live;
+            baseP99 = p99;
+        } else if (reports > options.Warmup) {
+            if (p99 > baseP99 + uint64_t(options.MaxP99GrowthUs * 1e3))
+                failures.push_back(boost::str(boost::format("p99 latency grew from %.0f to %.0f us")
+                                              % (baseP99 / 1e3) % (p99 / 1e3)));
+            if (rss > baseRss + uint64_t(options.MaxRssGrowthMb * 1048576))
+                failures.push_back(boost::str(boost::format("RSS grew by more than %g MB") % options.MaxRssGrowthMb));
+            if (live > baseLive + options.MaxLiveGrowth)
+                failures.push_back("live allocations grew by " + std::to_string(live - baseLive));
+        }
+    }
+
+    if (sensor) {
+        reportedLost += sensor->getRealTimeDataGaps().LostSamples;
+        if (!disconnect(sensor))
+            failures.push_back("the receiving thread did not finish");
+    }
+    Logger::instance().flush();
+    if (failures.empty() && reportedLost != checker.lost())
+        failures.push_back(boost::str(boost::format("the SDK reported %lu lost samples instead of %lu")
+                                      % reportedLost % checker.lost()));
+    for (auto &failure : failures)
+        std::printf("FAIL: %s\n", failure.c_str());
+    if (failures.empty())
+        std::printf("PASS: %lu samples, %lu lost to corrupted frames, %lu reconnects\n",
+                    (unsigned long) checker.samples(), (unsigned long) checker.lost(), (unsigned long) reconnects);
+    return failures.empty() ? 0 : 1;
+}
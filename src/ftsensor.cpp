@@ -0,0 +1,35 @@
+/*
+This file is part of SRI-FTSensor-SDK.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The compiled part of the SDK, built as the CMake target sri_ftsensor
+
+#ifndef SRI_FTSENSOR_SDK_SEPARATE_COMPILATION
+#error "src/ftsensor.cpp is built with SRI_FTSENSOR_SDK_SEPARATE_COMPILATION, see CMakeLists.txt"
+#endif
+
+#include <sri/ftsensor.hpp>
+#include <sri/commfactory.hpp>
+
+#include <sri/impl/responseparser.ipp>
+#include <sri/impl/commfactory.ipp>
+#include <sri/impl/commethernet.ipp>
+#include <sri/impl/ftsensor.ipp>
+
+namespace SRI {
+    SRI_FTSENSOR_SDK_RT_TEMPLATES(, float)
+    SRI_FTSENSOR_SDK_RT_TEMPLATES(, uint16_t)
+} //namespace SRI
@@ -0,0 +1,255 @@
+//
+// Checks that receiving real time data does not allocate per frame once it runs, registered with ctest.
+// A stand-in transport generates M8128 frames in memory on every poll, so the receiving loop runs as fast as
+// it can. Each case is warmed up by a number of samples, then every allocation made by any thread while the
+// next samples arrive is counted by the replaced operator new. Exits with 1 if a case allocates.
+//
+
+#include <sri/ftsensor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+using namespace SRI;
+
+static std::atomic<bool> countAllocations{false};
+static std::atomic<long> allocations{0};
+
+void *operator new(size_t size) {
+    if (countAllocations)
+        allocations++;
+    void *p = std::malloc(size > 0 ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+/// Answers every command with OK and streams numbered frames of 6 float channels after AT+GSD
+class FakeComm : public SensorComm {
+public:
+    /// \param samplesPerFrame  Samples per channel in a frame, as set by PNpCH
+    /// \param maxRead          Maximum bytes returned by a read, to split frames between reads
+    FakeComm(int samplesPerFrame, size_t maxRead)
+            : _samplesPerFrame(samplesPerFrame), _maxRead(maxRead) {
+        _pending.reserve(1 << 16);
+    }
+
+    ~FakeComm() override {
+        stopTransactions();
+    }
+
+    bool initialize() override {
+        _validStatus = true;
+        return true;
+    }
+
+    size_t write(std::vector<int8_t> &buf) override {
+        return write(std::string(buf.begin(), buf.end()));
+    }
+
+    size_t write(const std::string &buf) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (buf == "AT+GSD\r\n") {
+            _streaming = true;
+        } else if (buf == "AT+GSD=STOP\r\n") {
+            _streaming = false;
+        } else {
+            // AT+SMPR=?\r\n is answered with ACK+SMPR=1000$OK\r\n, a setting with itself
+            std::string response = "ACK+" + buf.substr(3, buf.size() - 5);
+            size_t query = response.find("=?");
+            if (query != std::string::npos)
+                response = response.substr(0, query) + "=1000";
+            response += "$OK\r\n";
+            _pending.insert(_pending.end(), response.begin(), response.end());
+        }
+        return buf.size();
+    }
+
+    size_t write(char *buf, size_t n) override {
+        return write(std::string(buf, n));
+    }
+
+    size_t read(std::vector<int8_t> &buf) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        buf.assign(_pending.begin(), _pending.end());
+        _pending.clear();
+        return buf.size();
+    }
+
+    size_t read(std::string &buf) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        buf.assign(_pending.begin(), _pending.end());
+        _pending.clear();
+        return buf.size();
+    }
+
+    size_t read(char *buf, size_t n) override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        n = std::min(n, std::min(_maxRead, _pending.size()));
+        std::memcpy(buf, _pending.data(), n);
+        _pending.erase(_pending.begin(), _pending.begin() + n);
+        return n;
+    }
+
+    size_t available() override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_streaming && _pending.empty())
+            appendFrame();
+        return std::min(_maxRead, _pending.size());
+    }
+
+private:
+    /// Append a frame whose channel c of sample s carries counter * 10 + c
+    void appendFrame() {
+        size_t values = 6 * size_t(_samplesPerFrame);
+        size_t length = 2 + values * sizeof(float) + 1; // counter, payload and checksum
+        size_t begin = _pending.size();
+        _pending.resize(begin + 4 + length);
+        int8_t *frame = &_pending[begin];
+        frame[0] = int8_t(0xAA);
+        frame[1] = int8_t(0x55);
+        frame[2] = int8_t(length >> 8);
+        frame[3] = int8_t(length & 0xFF);
+        frame[4] = int8_t(_counter >> 8);
+        frame[5] = int8_t(_counter & 0xFF);
+        uint8_t sum = 0;
+        for (size_t i = 0; i < values; i++) {
+            float value = float(_counter % 1000) * 10 + float(i % 6);
+            std::memcpy(frame + 6 + i * sizeof(float), &value, sizeof(float));
+        }
+        for (size_t i = 0; i < values * sizeof(float); i++) {
+            sum += uint8_t(frame[6 + i]);
+        }
+        frame[6 + values * sizeof(float)] = int8_t(sum);
+        _counter++;
+    }
+
+    int _samplesPerFrame;
+    size_t _maxRead;
+    std::mutex _mutex;
+    std::vector<int8_t> _pending;      // bytes not read yet
+    bool _streaming = false;
+    uint16_t _counter = 0;
+};
+
+struct Case {
+    const char *Name;
+    bool Columns;                      // startRealTimeDataColumns instead of startRealTimeDataRepeatedly
+    bool Callable;                     // a lambda instead of a boost::function
+    size_t MaxRead;
+    size_t BatchSamples;
+    uint32_t BatchDelayUs;
+    size_t QueueCapacity;              // 0 for no queue
+    OverflowPolicy Policy;
+    uint32_t HandlerDelayUs;           // makes the callback slower than the sensor
+};
+
+static bool waitForSamples(const std::atomic<long> &samples, long count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (samples < count) {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/// \return true if the case did not allocate after the warm-up
+static bool runCase(const Case &c) {
+    const long warmUpSamples = 20000;
+    const long measuredSamples = 50000;
+
+    FTSensor sensor(new FakeComm(5, c.MaxRead));
+    if (c.QueueCapacity > 0)
+        sensor.setRealTimeDataQueue(c.Policy, c.QueueCapacity);
+    sensor.setRealTimeDataBatch(c.BatchSamples, c.BatchDelayUs);
+
+    RTDataMode mode;
+    mode.PNpCH = 5;
+    std::atomic<long> samples{0};
+    uint32_t delayUs = c.HandlerDelayUs;
+    auto sleep = [delayUs]() {
+        if (delayUs > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+    };
+
+    if (c.Columns) {
+        auto handler = [&samples, sleep](RTColumns &columns) {
+            samples += long(columns.size());
+            sleep();
+        };
+        if (c.Callable)
+            sensor.startRealTimeDataColumns<float>(handler, mode, "SUM");
+        else
+            sensor.startRealTimeDataColumns<float>(boost::function<void(RTColumns&)>(handler), mode, "SUM");
+    } else {
+        auto handler = [&samples, sleep](std::vector<RTData<float>> &rtData) {
+            samples += long(rtData.size());
+            sleep();
+        };
+        if (c.Callable)
+            sensor.startRealTimeDataRepeatedly<float>(handler, mode, "SUM");
+        else
+            sensor.startRealTimeDataRepeatedly<float>(
+                    boost::function<void(std::vector<RTData<float>>&)>(handler), mode, "SUM");
+    }
+
+    bool received = waitForSamples(samples, warmUpSamples);
+    allocations = 0;
+    countAllocations = true;
+    long begin = samples;
+    received = received && waitForSamples(samples, begin + measuredSamples);
+    countAllocations = false;
+    long allocated = allocations;
+    long measured = samples - begin;
+
+    sensor.stopRealTimeDataRepeatedly();
+    sensor.waitRealTimeDataFinished();
+
+    bool passed = received && allocated == 0;
+    std::printf("%-40s %s: %ld allocations in %ld samples\n", c.Name, passed ? "passed" : "FAILED",
+                allocated, measured);
+    return passed;
+}
+
+int main() {
+    Logger::instance().setLevel(LogLevel::Warning);
+
+    const size_t whole = 1 << 20;
+    const Case cases[] = {
+            {"columns",                                true,  false, whole, 1,    0,    0, OverflowPolicy::Block,         0},
+            {"columns, split frames",                  true,  true,  37,    1,    0,    0, OverflowPolicy::Block,         0},
+            {"rows",                                   false, false, whole, 1,    0,    0, OverflowPolicy::Block,         0},
+            {"rows, callable, split frames",           false, true,  37,    1,    0,    0, OverflowPolicy::Block,         0},
+            {"rows, batches",                          false, false, 37,    16,   0,    0, OverflowPolicy::Block,         0},
+            {"rows, batches by delay",                 false, false, 37,    1000, 1000, 0, OverflowPolicy::Block,         0},
+            {"rows, queue",                            false, false, whole, 1,    0,    8, OverflowPolicy::Block,         0},
+            {"rows, queue, batches by delay",          false, false, 37,    1000, 1000, 8, OverflowPolicy::Block,         0},
+            {"rows, queue dropping the oldest",        false, false, whole, 1,    0,    4, OverflowPolicy::DropOldest,    50},
+            {"rows, queue replacing the newest",       false, false, whole, 16,   0,    4, OverflowPolicy::ReplaceNewest, 50},
+            {"columns, queue, batches by delay",       true,  false, 37,    1000, 1000, 8, OverflowPolicy::Block,         0},
+            {"columns, queue dropping the newest",     true,  false, whole, 1,    0,    4, OverflowPolicy::DropNewest,    50},
+    };
+
+    int failed = 0;
+    for (const Case &c : cases) {
+        if (!runCase(c))
+            failed++;
+    }
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+//
+// Example of the coroutine layer, built with -DSRI_FTSENSOR_SDK_COROUTINES=ON and C++20
+//
+
+#include <sri/coroutine.hpp>
+#include <sri/commethernet.hpp>
+
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <iostream>
+
+using namespace SRI;
+
+boost::asio::awaitable<void> monitor(AwaitableSensor &sensor) {
+    std::cout << "IP Address: " << co_await sensor.asyncGetIpAddress() << std::endl;
+    std::cout << "Sampling rate: " << co_await sensor.asyncGetSamplingRate() << std::endl;
+
+    RTDataMode rtMode = co_await sensor.asyncGetRealTimeDataMode();
+    RTDataValid rtValid = co_await sensor.asyncGetRealTimeDataValid();
+
+    auto stream = sensor.streamRealTimeData<float>(rtMode, rtValid);
+    auto executor = co_await boost::asio::this_coro::executor;
+    boost::asio::steady_timer timer(executor, std::chrono::seconds(10));
+    timer.async_wait([&sensor](const boost::system::error_code &) { sensor.stopRealTimeData(); });
+
+    RTColumns batch;
+    while (co_await stream->next(batch)) {
+        std::cout << batch.size() << " samples, Ch 0: " << batch(0, 0) << std::endl;
+    }
+}
+
+int main() {
+    SRI::CommEthernet* ce = new SRI::CommEthernet("192.168.1.108", 4008);
+    SRI::FTSensor ftSensor(ce);
+    ftSensor.setRealTimeDataBatch(100);
+    AwaitableSensor sensor(ftSensor);
+
+    boost::asio::io_context io;
+    boost::asio::co_spawn(io, monitor(sensor), boost::asio::detached);
+    io.run();
+}